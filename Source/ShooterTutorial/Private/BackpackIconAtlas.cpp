@@ -0,0 +1,166 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "BackpackIconAtlas.h"
+#include "Engine/CanvasRenderTarget2D.h"
+#include "Engine/Canvas.h"
+#include "Engine/Texture2D.h"
+#include "Kismet/GameplayStatics.h"
+#include "ShooterGameInstance.h"
+
+/* Draws an icon at a position and repeats its edge texels into Padding pixels around it */
+static void DrawPaddedIcon(UCanvas* Canvas, UTexture2D* Icon, const FVector2D& Position, float Size, float Padding)
+{
+	// A zero sized UV area on the centre of the outermost texels stretches exactly those texels over the border
+	const FVector2D HalfTexel(0.5f / FMath::Max(Icon->GetSurfaceWidth(), 1.0f), 0.5f / FMath::Max(Icon->GetSurfaceHeight(), 1.0f));
+	const float UVMin[] = { HalfTexel.X, 0.0f, 1.0f - HalfTexel.X };
+	const float VMin[] = { HalfTexel.Y, 0.0f, 1.0f - HalfTexel.Y };
+	const float UVSize[] = { 0.0f, 1.0f, 0.0f };
+	const float Offsets[] = { -Padding, 0.0f, Size };
+	const float Sizes[] = { Padding, Size, Padding };
+
+	// Three by three pieces: the corners, the edges and the icon itself in the middle
+	for (int32 Row = 0; Row < 3; ++Row)
+	{
+		for (int32 Column = 0; Column < 3; ++Column)
+		{
+			// Opaque blending copies the icon's alpha into the atlas instead of blending it away
+			Canvas->K2_DrawTexture(Icon, Position + FVector2D(Offsets[Column], Offsets[Row]), FVector2D(Sizes[Column], Sizes[Row]),
+				FVector2D(UVMin[Column], VMin[Row]), FVector2D(UVSize[Column], UVSize[Row]), FLinearColor::White, BLEND_Opaque);
+		}
+	}
+}
+
+void UBackpackIconAtlas::Build(UObject* WorldContextObject, const TArray<FStringAssetReference>& InIconPaths)
+{
+	this->CellUVs.Reset();
+	this->IconPaths = InIconPaths;
+	this->WorldContext = WorldContextObject;
+	this->MissingIconsHandle.Reset();
+
+	if (this->IconPaths.Num() == 0)
+	{
+		this->AtlasTexture = nullptr;
+		return;
+	}
+
+	// Cells fit the largest icon, so no icon is drawn smaller than it was authored
+	int32 LargestIconSize = 0;
+	for (const FStringAssetReference& IconPath : this->IconPaths)
+	{
+		const UTexture2D* Icon = Cast<UTexture2D>(IconPath.ResolveObject());
+		if (Icon)
+		{
+			LargestIconSize = FMath::Max(LargestIconSize, FMath::Max(Icon->GetSizeX(), Icon->GetSizeY()));
+		}
+	}
+
+	const int32 WantedCellSize = LargestIconSize > 0 ? LargestIconSize : (int32)DefaultCellSize;
+
+	// Square grid in a power of two texture, with cells shrunk to keep it within MaxAtlasSize
+	this->NumColumns = FMath::CeilToInt(FMath::Sqrt((float)this->IconPaths.Num()));
+	this->CellSize = FMath::Clamp(WantedCellSize, 1, FMath::Max(MaxAtlasSize / this->NumColumns - 2 * CellPadding, 1));
+
+	if (this->CellSize < WantedCellSize)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Build:: %d icons of %d pixels do not fit in a %d pixel atlas, cells shrink to %d pixels"), this->IconPaths.Num(), WantedCellSize, MaxAtlasSize, this->CellSize)
+	}
+
+	const int32 CellPitch = this->CellSize + 2 * CellPadding;
+	const int32 NumRows = FMath::DivideAndRoundUp(this->IconPaths.Num(), this->NumColumns);
+	const int32 AtlasWidth = FMath::RoundUpToPowerOfTwo(this->NumColumns * CellPitch);
+	const int32 AtlasHeight = FMath::RoundUpToPowerOfTwo(NumRows * CellPitch);
+
+	// Half a texel in from the icon's edges, so bilinear filtering only ever blends texels of the same icon
+	const FVector2D TexelSize(1.0f / AtlasWidth, 1.0f / AtlasHeight);
+	const FVector2D CellExtent = FVector2D(this->CellSize - 1, this->CellSize - 1) * TexelSize;
+
+	this->CellUVs.Reserve(this->IconPaths.Num());
+	for (int32 CellIndex = 0; CellIndex < this->IconPaths.Num(); ++CellIndex)
+	{
+		const FVector2D CellPixel((CellIndex % this->NumColumns) * CellPitch + CellPadding + 0.5f, (CellIndex / this->NumColumns) * CellPitch + CellPadding + 0.5f);
+		const FVector2D CellMin = CellPixel * TexelSize;
+		this->CellUVs.Add(FBox2D(CellMin, CellMin + CellExtent));
+	}
+
+	this->AtlasTexture = UCanvasRenderTarget2D::CreateCanvasRenderTarget2D(WorldContextObject, UCanvasRenderTarget2D::StaticClass(), AtlasWidth, AtlasHeight);
+	if (this->AtlasTexture == nullptr)
+	{
+		UE_LOG(LogTemp, Error, TEXT("Build:: could not create the icon atlas render target"))
+		return;
+	}
+
+	this->AtlasTexture->ClearColor = FLinearColor::Transparent;
+	this->AtlasTexture->OnCanvasRenderTargetUpdate.AddDynamic(this, &UBackpackIconAtlas::DrawAtlas);
+	this->AtlasTexture->UpdateResource();
+}
+
+void UBackpackIconAtlas::DrawAtlas(UCanvas* Canvas, int32 Width, int32 Height)
+{
+	TArray<FStringAssetReference> MissingIconPaths;
+
+	for (int32 CellIndex = 0; CellIndex < this->IconPaths.Num(); ++CellIndex)
+	{
+		// Only what is resident is drawn; the first build loads every icon beforehand
+		UTexture2D* Icon = Cast<UTexture2D>(this->IconPaths[CellIndex].ResolveObject());
+		if (Icon == nullptr)
+		{
+			MissingIconPaths.Add(this->IconPaths[CellIndex]);
+			continue;
+		}
+
+		const int32 CellPitch = this->CellSize + 2 * CellPadding;
+		const FVector2D CellPosition((CellIndex % this->NumColumns) * CellPitch + CellPadding, (CellIndex / this->NumColumns) * CellPitch + CellPadding);
+		DrawPaddedIcon(Canvas, Icon, CellPosition, this->CellSize, CellPadding);
+	}
+
+	// The draw commands are queued, the icons of a redraw may go now
+	this->MissingIconsHandle.Reset();
+
+	if (MissingIconPaths.Num() > 0 && this->bRequestMissingIcons)
+	{
+		this->RequestMissingIcons(MissingIconPaths);
+	}
+}
+
+void UBackpackIconAtlas::RequestMissingIcons(const TArray<FStringAssetReference>& MissingIconPaths)
+{
+	UShooterGameInstance* ShooterGameInstance = Cast<UShooterGameInstance>(UGameplayStatics::GetGameInstance(this->WorldContext.Get()));
+	if (ShooterGameInstance == nullptr)
+	{
+		UE_LOG(LogTemp, Error, TEXT("RequestMissingIcons:: there is no shooter game instance, %d icons stay blank"), MissingIconPaths.Num())
+		return;
+	}
+
+	this->MissingIconsHandle = ShooterGameInstance->GetStreamableManager().RequestAsyncLoad(MissingIconPaths, FStreamableDelegate::CreateUObject(this, &UBackpackIconAtlas::OnMissingIconsLoaded));
+}
+
+void UBackpackIconAtlas::OnMissingIconsLoaded()
+{
+	// Icons that failed to load stay blank instead of being requested over and over
+	TSharedPtr<FStreamableHandle> LoadedIconsHandle = this->MissingIconsHandle;
+	if (this->AtlasTexture)
+	{
+		this->bRequestMissingIcons = false;
+		this->AtlasTexture->UpdateResource();
+		this->bRequestMissingIcons = true;
+	}
+
+	if (LoadedIconsHandle.IsValid())
+	{
+		LoadedIconsHandle->ReleaseHandle();
+	}
+}
+
+FSlateBrush UBackpackIconAtlas::MakeIconBrush(int32 CellIndex) const
+{
+	FSlateBrush Brush;
+	if (!this->CellUVs.IsValidIndex(CellIndex) || this->AtlasTexture == nullptr)
+	{
+		return Brush;
+	}
+
+	Brush.SetResourceObject(this->AtlasTexture);
+	Brush.ImageSize = FVector2D(this->CellSize, this->CellSize);
+	Brush.SetUVRegion(this->CellUVs[CellIndex]);
+	return Brush;
+}
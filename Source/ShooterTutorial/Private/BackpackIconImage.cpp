@@ -0,0 +1,68 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "BackpackIconImage.h"
+#include "GameFramework/PlayerController.h"
+#include "GameplayPlayerCharacter.h"
+
+void UBackpackIconImage::SetBackpackItemIndex(int32 NewBackpackItemIndex)
+{
+	this->BackpackItemIndex = NewBackpackItemIndex;
+	this->RefreshIcon();
+}
+
+void UBackpackIconImage::RefreshIcon()
+{
+	AGameplayPlayerCharacter* Character = this->GetOwningCharacter();
+	if (Character == nullptr)
+	{
+		return;
+	}
+
+	const FSlateBrush Brush = Character->GetBackpackIconBrush(this->BackpackItemIndex);
+	if (Brush.GetResourceObject())
+	{
+		SetBrush(Brush);
+	}
+}
+
+TSharedRef<SWidget> UBackpackIconImage::RebuildWidget()
+{
+	TSharedRef<SWidget> Widget = Super::RebuildWidget();
+
+	if (!IsDesignTime())
+	{
+		AGameplayPlayerCharacter* Character = this->GetOwningCharacter();
+		if (Character)
+		{
+			Character->OnBackpackIconsLoadedDelegate.AddUniqueDynamic(this, &UBackpackIconImage::OnBackpackIconsLoaded);
+			this->BoundCharacter = Character;
+		}
+
+		this->RefreshIcon();
+	}
+
+	return Widget;
+}
+
+void UBackpackIconImage::ReleaseSlateResources(bool bReleaseChildren)
+{
+	Super::ReleaseSlateResources(bReleaseChildren);
+
+	if (this->BoundCharacter.IsValid())
+	{
+		this->BoundCharacter->OnBackpackIconsLoadedDelegate.RemoveDynamic(this, &UBackpackIconImage::OnBackpackIconsLoaded);
+	}
+
+	this->BoundCharacter.Reset();
+}
+
+void UBackpackIconImage::OnBackpackIconsLoaded()
+{
+	this->RefreshIcon();
+}
+
+AGameplayPlayerCharacter* UBackpackIconImage::GetOwningCharacter() const
+{
+	APlayerController* PlayerController = GetOwningPlayer();
+	return PlayerController ? Cast<AGameplayPlayerCharacter>(PlayerController->GetPawn()) : nullptr;
+}
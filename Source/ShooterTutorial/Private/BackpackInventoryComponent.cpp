@@ -0,0 +1,288 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "BackpackInventoryComponent.h"
+#include "UnrealNetwork.h"
+
+/* Bit of an item state holding the item's selection, the others hold its slot */
+static const uint8 ItemStateSelectedBit = 0x80;
+
+UBackpackInventoryComponent::UBackpackInventoryComponent()
+{
+	// Everything happens on calls, nothing per frame
+	PrimaryComponentTick.bCanEverTick = false;
+
+	bReplicates = true;
+}
+
+void UBackpackInventoryComponent::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	// Nobody but the owner opens this backpack
+	DOREPLIFETIME_CONDITION(UBackpackInventoryComponent, ReplicatedItems, COND_OwnerOnly);
+}
+
+void UBackpackInventoryComponent::OnRep_ReplicatedItems()
+{
+	// The server's list replaces whatever was built locally, including the starting backpack and predicted selections
+	this->Items.SetNum(this->ReplicatedItems.Num());
+	for (int32 ItemIndex = 0; ItemIndex < this->ReplicatedItems.Num(); ++ItemIndex)
+	{
+		const FReplicatedBackpackItem& ReplicatedItem = this->ReplicatedItems[ItemIndex];
+		FWeaponBackpackItem& Item = this->Items[ItemIndex];
+
+		Item.WeaponToSpawnAsset = ReplicatedItem.WeaponToSpawnAsset;
+		Item.BackpackImageAsset = ReplicatedItem.BackpackImageAsset;
+		Item.WeaponType = ReplicatedItem.WeaponType;
+		Item.bIsSelected = (ReplicatedItem.State & ItemStateSelectedBit) != 0;
+		Item.InSlot = ReplicatedItem.State & ~ItemStateSelectedBit;
+	}
+
+	this->RebuildIndices();
+	this->OnItemsChangedDelegate.Broadcast(INDEX_NONE);
+}
+
+void UBackpackInventoryComponent::PackItem(int32 ItemIndex)
+{
+	if (GetOwnerRole() != ROLE_Authority)
+	{
+		return;
+	}
+
+	const FWeaponBackpackItem& Item = this->Items[ItemIndex];
+	this->ReplicatedItems.SetNum(this->Items.Num());
+
+	FReplicatedBackpackItem& ReplicatedItem = this->ReplicatedItems[ItemIndex];
+	ReplicatedItem.WeaponToSpawnAsset = Item.WeaponToSpawnAsset;
+	ReplicatedItem.BackpackImageAsset = Item.BackpackImageAsset;
+	ReplicatedItem.WeaponType = Item.WeaponType;
+
+	this->PackItemState(ItemIndex);
+}
+
+void UBackpackInventoryComponent::PackItemState(int32 ItemIndex)
+{
+	if (GetOwnerRole() != ROLE_Authority || !this->ReplicatedItems.IsValidIndex(ItemIndex))
+	{
+		return;
+	}
+
+	const FWeaponBackpackItem& Item = this->Items[ItemIndex];
+	this->ReplicatedItems[ItemIndex].State = (uint8)FMath::Clamp(Item.InSlot, 0, 0x7F) | (Item.bIsSelected ? ItemStateSelectedBit : 0);
+}
+
+void UBackpackInventoryComponent::SetItems(const TArray<FWeaponBackpackItem>& NewItems)
+{
+	// A client only seeds its starting backpack until the server's list arrives; once it has, that list wins
+	if (GetOwnerRole() != ROLE_Authority && this->ReplicatedItems.Num() > 0)
+	{
+		this->OnRep_ReplicatedItems();
+		return;
+	}
+
+	this->Items = NewItems;
+	for (FWeaponBackpackItem& Item : this->Items)
+	{
+		this->PrepareItem(Item);
+	}
+
+	this->RebuildIndices();
+	this->OnItemsChangedDelegate.Broadcast(INDEX_NONE);
+}
+
+int32 UBackpackInventoryComponent::AddItem(const FWeaponBackpackItem& Item)
+{
+	// Clients get the server's list; an item added here alone would shift every index after it
+	if (GetOwnerRole() != ROLE_Authority)
+	{
+		UE_LOG(LogTemp, Error, TEXT("AddItem:: only the server can add items"))
+		return INDEX_NONE;
+	}
+
+	const int32 ItemIndex = this->Items.Add(Item);
+	this->PrepareItem(this->Items[ItemIndex]);
+	this->SelectedItems.Add(false);
+	this->IndexItem(ItemIndex);
+
+	this->OnItemsChangedDelegate.Broadcast(INDEX_NONE);
+	return ItemIndex;
+}
+
+void UBackpackInventoryComponent::PrepareItem(FWeaponBackpackItem& Item) const
+{
+	Item.MigrateToSoftReferences();
+	Item.UpdateWeaponType();
+}
+
+void UBackpackInventoryComponent::RemoveItem(int32 ItemIndex)
+{
+	if (GetOwnerRole() != ROLE_Authority)
+	{
+		UE_LOG(LogTemp, Error, TEXT("RemoveItem:: only the server can remove items"))
+		return;
+	}
+
+	if (!this->Items.IsValidIndex(ItemIndex))
+	{
+		UE_LOG(LogTemp, Error, TEXT("RemoveItem:: ItemIndex %d is out of range"), ItemIndex)
+		return;
+	}
+
+	this->Items.RemoveAt(ItemIndex);
+	this->RebuildIndices();
+	this->OnItemsChangedDelegate.Broadcast(INDEX_NONE);
+}
+
+bool UBackpackInventoryComponent::SetItemSelected(int32 ItemIndex, bool bIsSelected, int32 Slot)
+{
+	if (!this->Items.IsValidIndex(ItemIndex))
+	{
+		UE_LOG(LogTemp, Error, TEXT("SetItemSelected:: ItemIndex %d is out of range"), ItemIndex)
+		return false;
+	}
+
+	FWeaponBackpackItem& Item = this->Items[ItemIndex];
+
+	if (Item.bIsSelected != bIsSelected)
+	{
+		Item.bIsSelected = bIsSelected;
+		this->SelectedItems[ItemIndex] = bIsSelected;
+		this->NumSelected += bIsSelected ? 1 : -1;
+	}
+
+	if (Item.InSlot != Slot)
+	{
+		// Leave the old slot, if this item is what it holds
+		const int32* OldSlotItem = this->SlotToItem.Find(Item.InSlot);
+		if (OldSlotItem && *OldSlotItem == ItemIndex)
+		{
+			this->SlotToItem.Remove(Item.InSlot);
+		}
+
+		Item.InSlot = Slot;
+
+		if (Slot != 0)
+		{
+			// A slot holds one item; whatever was there is taken out of it
+			const int32* PreviousItem = this->SlotToItem.Find(Slot);
+			if (PreviousItem && *PreviousItem != ItemIndex)
+			{
+				const int32 PreviousItemIndex = *PreviousItem;
+				this->Items[PreviousItemIndex].InSlot = 0;
+				this->PackItemState(PreviousItemIndex);
+				this->OnItemsChangedDelegate.Broadcast(PreviousItemIndex);
+			}
+
+			this->SlotToItem.Add(Slot, ItemIndex);
+		}
+	}
+
+	this->PackItemState(ItemIndex);
+	this->OnItemsChangedDelegate.Broadcast(ItemIndex);
+	return true;
+}
+
+int32 UBackpackInventoryComponent::GetItemInSlot(int32 Slot) const
+{
+	const int32* ItemIndex = this->SlotToItem.Find(Slot);
+	return ItemIndex ? *ItemIndex : INDEX_NONE;
+}
+
+void UBackpackInventoryComponent::GetSelectedItems(TArray<int32>& OutItemIndices) const
+{
+	OutItemIndices.Reset(this->NumSelected);
+	for (TConstSetBitIterator<> It(this->SelectedItems); It; ++It)
+	{
+		OutItemIndices.Add(It.GetIndex());
+	}
+}
+
+void UBackpackInventoryComponent::GetItemsOfType(EWeaponType WeaponType, TArray<int32>& OutItemIndices) const
+{
+	const TArray<int32>* ItemIndices = this->FindItemsOfType(WeaponType);
+	if (ItemIndices)
+	{
+		OutItemIndices = *ItemIndices;
+	}
+	else
+	{
+		OutItemIndices.Reset();
+	}
+}
+
+void UBackpackInventoryComponent::GetItemsSortedByType(TArray<int32>& OutItemIndices) const
+{
+	OutItemIndices.Reset(this->Items.Num());
+
+	// Type lists are kept in index order; walking the few types in enum order is all the sorting needed
+	TArray<uint8> WeaponTypes;
+	this->TypeToItems.GenerateKeyArray(WeaponTypes);
+	WeaponTypes.Sort();
+
+	for (uint8 WeaponType : WeaponTypes)
+	{
+		OutItemIndices.Append(this->TypeToItems.FindChecked(WeaponType));
+	}
+}
+
+void UBackpackInventoryComponent::GetItemsSortedBySlot(TArray<int32>& OutItemIndices) const
+{
+	// At most one item per slot, and only a handful of slots
+	TArray<int32> Slots;
+	this->SlotToItem.GenerateKeyArray(Slots);
+	Slots.Sort();
+
+	OutItemIndices.Reset(Slots.Num());
+	for (int32 Slot : Slots)
+	{
+		OutItemIndices.Add(this->SlotToItem.FindChecked(Slot));
+	}
+}
+
+void UBackpackInventoryComponent::IndexItem(int32 ItemIndex)
+{
+	FWeaponBackpackItem& Item = this->Items[ItemIndex];
+
+	if (Item.bIsSelected)
+	{
+		this->SelectedItems[ItemIndex] = true;
+		this->NumSelected++;
+	}
+
+	if (Item.InSlot != 0)
+	{
+		// Designers may have put two items in one slot; the first one keeps it
+		if (this->SlotToItem.Contains(Item.InSlot))
+		{
+			UE_LOG(LogTemp, Warning, TEXT("IndexItem:: slot %d already holds an item, item %d is taken out of it"), Item.InSlot, ItemIndex)
+			Item.InSlot = 0;
+		}
+		else
+		{
+			this->SlotToItem.Add(Item.InSlot, ItemIndex);
+		}
+	}
+
+	// Items are indexed in increasing order, so every type list stays sorted
+	this->TypeToItems.FindOrAdd((uint8)Item.WeaponType).Add(ItemIndex);
+
+	this->PackItem(ItemIndex);
+}
+
+void UBackpackInventoryComponent::RebuildIndices()
+{
+	if (GetOwnerRole() == ROLE_Authority)
+	{
+		this->ReplicatedItems.SetNum(this->Items.Num());
+	}
+
+	this->SelectedItems.Init(false, this->Items.Num());
+	this->NumSelected = 0;
+	this->SlotToItem.Reset();
+	this->TypeToItems.Reset();
+
+	for (int32 ItemIndex = 0; ItemIndex < this->Items.Num(); ++ItemIndex)
+	{
+		this->IndexItem(ItemIndex);
+	}
+}
@@ -0,0 +1,147 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "BaseProjectile.h"
+#include "Engine/World.h"
+#include "TimerManager.h"
+#include "Kismet/GameplayStatics.h"
+#include "GameFramework/DamageType.h"
+#include "ProjectilePool.h"
+
+ABaseProjectile::ABaseProjectile()
+{
+	// Projectiles are driven by their movement component, the actor itself never ticks
+	PrimaryActorTick.bCanEverTick = false;
+
+	this->CollisionComponent = CreateDefaultSubobject<USphereComponent>(TEXT("CollisionComponent"));
+	this->CollisionComponent->InitSphereRadius(5.0f);
+	this->CollisionComponent->SetCollisionProfileName(TEXT("BlockAllDynamic"));
+	RootComponent = this->CollisionComponent;
+
+	this->ProjectileMovement = CreateDefaultSubobject<UProjectileMovementComponent>(TEXT("ProjectileMovement"));
+	this->ProjectileMovement->SetUpdatedComponent(this->CollisionComponent);
+	this->ProjectileMovement->InitialSpeed = 2500.0f;
+	this->ProjectileMovement->MaxSpeed = 2500.0f;
+	this->ProjectileMovement->bRotationFollowsVelocity = true;
+	this->ProjectileMovement->bShouldBounce = true;
+	this->ProjectileMovement->bAutoActivate = false;
+
+	this->bIsActiveInWorld = false;
+}
+
+void ABaseProjectile::BeginPlay()
+{
+	Super::BeginPlay();
+
+	this->ProjectileMovement->OnProjectileBounce.AddDynamic(this, &ABaseProjectile::OnHandleProjectileBounce);
+	this->ProjectileMovement->OnProjectileStop.AddDynamic(this, &ABaseProjectile::OnHandleProjectileStop);
+}
+
+void ABaseProjectile::ActivateFromPool(const FTransform& LaunchTransform, AActor* NewOwner, APawn* NewInstigator, float CatchUpTime)
+{
+	SetOwner(NewOwner);
+	this->Instigator = NewInstigator;
+
+	this->CollisionComponent->ClearMoveIgnoreActors();
+	if (NewOwner)
+	{
+		this->CollisionComponent->IgnoreActorWhenMoving(NewOwner, true);
+	}
+
+	SetActorTransform(LaunchTransform, false, nullptr, ETeleportType::TeleportPhysics);
+	SetActorHiddenInGame(false);
+	SetActorEnableCollision(true);
+
+	// A stopped movement component forgets what it moves, so hook it up again
+	this->ProjectileMovement->SetUpdatedComponent(this->CollisionComponent);
+	this->ProjectileMovement->Velocity = LaunchTransform.GetRotation().GetForwardVector() * this->ProjectileMovement->InitialSpeed;
+	this->ProjectileMovement->Activate(true);
+
+	this->bIsActiveInWorld = true;
+
+	CatchUpTime = FMath::Clamp(CatchUpTime, 0.0f, this->MaxFlightTime);
+	GetWorldTimerManager().SetTimer(this->FlightTimerHandle, this, &ABaseProjectile::OnHandleFlightTimeOver, FMath::Max(this->MaxFlightTime - CatchUpTime, KINDA_SMALL_NUMBER), false);
+
+	// A shot fired in the past flies the time it missed right away; a hit on the way explodes it as usual
+	if (CatchUpTime > KINDA_SMALL_NUMBER)
+	{
+		this->ProjectileMovement->TickComponent(CatchUpTime, LEVELTICK_All, nullptr);
+	}
+}
+
+void ABaseProjectile::DeactivateToPool()
+{
+	GetWorldTimerManager().ClearTimer(this->FlightTimerHandle);
+
+	this->ProjectileMovement->StopMovementImmediately();
+	this->ProjectileMovement->Deactivate();
+
+	SetActorHiddenInGame(true);
+	SetActorEnableCollision(false);
+	SetOwner(nullptr);
+	this->Instigator = nullptr;
+
+	this->bIsActiveInWorld = false;
+}
+
+void ABaseProjectile::Explode()
+{
+	if (!this->bIsActiveInWorld)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Explode:: projectile is not in flight"))
+		return;
+	}
+
+	const FVector ExplosionLocation = GetActorLocation();
+
+	if (this->ExplosionSound)
+	{
+		UGameplayStatics::PlaySoundAtLocation(this, this->ExplosionSound, ExplosionLocation);
+	}
+
+	if (this->ExplosionEffect)
+	{
+		UGameplayStatics::SpawnEmitterAtLocation(GetWorld(), this->ExplosionEffect, ExplosionLocation);
+	}
+
+	if (this->ExplosionDamage > 0.0f && this->ExplosionRadius > 0.0f)
+	{
+		AController* InstigatorController = this->Instigator ? this->Instigator->GetController() : nullptr;
+		UGameplayStatics::ApplyRadialDamage(this, this->ExplosionDamage, ExplosionLocation, this->ExplosionRadius, UDamageType::StaticClass(), TArray<AActor*>(), this, InstigatorController);
+	}
+
+	this->ReturnToPool();
+}
+
+void ABaseProjectile::OnHandleProjectileBounce(const FHitResult& ImpactResult, const FVector& ImpactVelocity)
+{
+	if (this->BounceSound)
+	{
+		UGameplayStatics::PlaySoundAtLocation(this, this->BounceSound, ImpactResult.ImpactPoint);
+	}
+}
+
+void ABaseProjectile::OnHandleProjectileStop(const FHitResult& ImpactResult)
+{
+	if (this->bExplodeOnStop)
+	{
+		this->Explode();
+	}
+}
+
+void ABaseProjectile::OnHandleFlightTimeOver()
+{
+	this->Explode();
+}
+
+void ABaseProjectile::ReturnToPool()
+{
+	UProjectilePool* ProjectilePool = UProjectilePool::Get(GetWorld());
+	if (ProjectilePool)
+	{
+		ProjectilePool->Release(this);
+	}
+	else
+	{
+		Destroy();
+	}
+}
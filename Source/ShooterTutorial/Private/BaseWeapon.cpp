@@ -1,24 +1,54 @@
 // Fill out your copyright notice in the Description page of Project Settings.
 
 #include "BaseWeapon.h"
+#include "Engine/World.h"
+#include "ProjectilePool.h"
+#include "WeaponCatalog.h"
+#include "WeaponStateStore.h"
 
 
 void ABaseWeapon::Fire_Implementation()
 {
+	// Every call keeps its own time until its shot is emitted
+	this->PendingShotTimestamps.Add(this->NextShotTimestamp >= 0.0f ? this->NextShotTimestamp : GetWorld()->GetTimeSeconds());
+	this->NextShotTimestamp = -1.0f;
+
+	// A store backed weapon fires when the store simulates it and then calls EmitShot
+	UWeaponStateStore* StateStore = UWeaponStateStore::Get(GetWorld());
+	if (StateStore && StateStore->IsValidAgent(this->StateStoreHandle))
+	{
+		StateStore->RequestFire(this->StateStoreHandle);
+		return;
+	}
+
 	this->CurrentAmmoInMag -= 1;
+	this->MarkAmmoDirty();
+
+	this->EmitShot();
 }
 
 void ABaseWeapon::Reload_Implementation()
 {
-	int32 minAmmo = FMath::Min<int32>(this->CurrentAmmoInBackpack, this->MaxAmmoInMag);
+	UWeaponStateStore* StateStore = UWeaponStateStore::Get(GetWorld());
+	if (StateStore && StateStore->IsValidAgent(this->StateStoreHandle))
+	{
+		StateStore->ApplyReload(this->StateStoreHandle);
+		this->CurrentAmmoInMag = StateStore->GetAmmoInMag(this->StateStoreHandle);
+		this->CurrentAmmoInBackpack = StateStore->GetAmmoInBackpack(this->StateStoreHandle);
+		this->MarkAmmoDirty();
+		return;
+	}
+
+	int32 minAmmo = FMath::Min<int32>(this->CurrentAmmoInBackpack, this->GetMaxAmmoInMag());
 	this->CurrentAmmoInMag = minAmmo;
 	this->CurrentAmmoInBackpack -= minAmmo;
+	this->MarkAmmoDirty();
 }
 
 void ABaseWeapon::HaveAmmoInMag(bool& HaveAmmo, bool& MagIsFull)
 {
 	HaveAmmo = this->CurrentAmmoInMag > 0;
-	MagIsFull = this->CurrentAmmoInMag == this->MaxAmmoInMag;
+	MagIsFull = this->CurrentAmmoInMag == this->GetMaxAmmoInMag();
 }
 
 void ABaseWeapon::HaveAmmoInBackpack(bool& HaveAmmo)
@@ -26,29 +56,386 @@ void ABaseWeapon::HaveAmmoInBackpack(bool& HaveAmmo)
 	HaveAmmo = this->CurrentAmmoInBackpack > 0;
 }
 
+int32 ABaseWeapon::GetMaxAmmoInMag() const
+{
+	const FWeaponStats* Stats = this->GetCatalogStats();
+	return Stats ? Stats->MaxAmmoInMag : this->MaxAmmoInMag;
+}
+
+int32 ABaseWeapon::GetMaxAmmoInBackpack() const
+{
+	const FWeaponStats* Stats = this->GetCatalogStats();
+	return Stats ? Stats->MaxAmmoInBackpack : this->MaxAmmoInBackpack;
+}
+
+float ABaseWeapon::GetReloadTime() const
+{
+	const FWeaponStats* Stats = this->GetCatalogStats();
+	return Stats ? Stats->ReloadTime : this->ReloadTime;
+}
+
+FName ABaseWeapon::GetAttachSocketNameFPP() const
+{
+	const FWeaponStats* Stats = this->GetCatalogStats();
+	return Stats ? Stats->AttachSocketNameFPP : this->AttachSocketNameFPP;
+}
+
+FName ABaseWeapon::GetAttachSocketNameTPP() const
+{
+	const FWeaponStats* Stats = this->GetCatalogStats();
+	return Stats ? Stats->AttachSocketNameTPP : this->AttachSocketNameTPP;
+}
+
+EWeaponType ABaseWeapon::GetWeaponType() const
+{
+	const FWeaponStats* Stats = this->GetCatalogStats();
+	return Stats ? Stats->WeaponType : this->WeaponType;
+}
+
+void ABaseWeapon::StartFiring()
+{
+	if (this->bTriggerHeld)
+	{
+		return;
+	}
+
+	this->bTriggerHeld = true;
+	this->FireAccumulator = 0.0f;
+
+	// The first round leaves as soon as the trigger is pulled
+	this->FireTriggerShot(GetWorld()->GetTimeSeconds());
+
+	// Only automatic weapons need to tick, and only while the trigger is held
+	if (this->bIsAutomatic)
+	{
+		SetActorTickEnabled(true);
+	}
+}
+
+void ABaseWeapon::StopFiring()
+{
+	this->bTriggerHeld = false;
+	this->FireAccumulator = 0.0f;
+
+	SetActorTickEnabled(false);
+}
+
+bool ABaseWeapon::FireTriggerShot(float ShotTime)
+{
+	if (this->OnTriggerShotDelegate.IsBound())
+	{
+		return this->OnTriggerShotDelegate.Execute(ShotTime);
+	}
+
+	// Nobody holds this weapon; fire it directly as long as there is ammo
+	if (this->CurrentAmmoInMag <= 0)
+	{
+		return false;
+	}
+
+	this->SetNextShotTimestamp(ShotTime);
+	this->Fire();
+	return true;
+}
+
+void ABaseWeapon::ResetWeaponState()
+{
+	// The catalog may have been rebaked while this weapon was in the pool
+	this->ResolveCatalogIndex();
+
+	// We are starting with full loading magazine
+	this->CurrentAmmoInMag = this->GetMaxAmmoInMag();
+	// and backpack filled with ammo
+	this->CurrentAmmoInBackpack = this->GetMaxAmmoInBackpack();
+	this->MarkAmmoDirty();
+	this->LastAcceptedShotTime = -MAX_FLT;
+
+	UWeaponStateStore* StateStore = UWeaponStateStore::Get(GetWorld());
+	if (StateStore && UWeaponStateStore::IsEnabled())
+	{
+		FWeaponAgentDesc AgentDesc;
+		AgentDesc.MaxAmmoInMag = this->GetMaxAmmoInMag();
+		AgentDesc.MaxAmmoInBackpack = this->GetMaxAmmoInBackpack();
+		AgentDesc.ReloadTime = this->GetReloadTime();
+
+		// From now on the store owns the ammo and this weapon only mirrors it
+		if (StateStore->IsValidAgent(this->StateStoreHandle))
+		{
+			StateStore->ResetAgent(this->StateStoreHandle, AgentDesc);
+		}
+		else
+		{
+			this->StateStoreHandle = StateStore->AddAgent(AgentDesc, this);
+		}
+	}
+}
+
+void ABaseWeapon::EmitShot()
+{
+	// Shots fired between two frames keep their own time; a held trigger in the store fires without calls to Fire, now
+	float Timestamp = GetWorld()->GetTimeSeconds();
+	if (this->PendingShotTimestamps.Num() > 0)
+	{
+		Timestamp = this->PendingShotTimestamps[0];
+		this->PendingShotTimestamps.RemoveAt(0, 1, false);
+	}
+
+	if (this->ProjectileClass)
+	{
+		this->LaunchProjectile(Timestamp);
+	}
+	else
+	{
+		this->QueueHitscanShot(Timestamp);
+	}
+
+	this->OnShotEmittedDelegate.ExecuteIfBound(this);
+}
+
+void ABaseWeapon::MarkAmmoDirty()
+{
+	// The ammo travels with the holder's acknowledgement of the action that changed it
+	AActor* WeaponOwner = GetOwner();
+	if (this->Role == ROLE_Authority && WeaponOwner)
+	{
+		WeaponOwner->ForceNetUpdate();
+	}
+}
+
+void ABaseWeapon::SetHolstered(bool bNewHolstered)
+{
+	if (this->bIsHolstered == bNewHolstered)
+	{
+		return;
+	}
+
+	this->bIsHolstered = bNewHolstered;
+	SetActorHiddenInGame(bNewHolstered);
+
+	if (bNewHolstered)
+	{
+		// A weapon in the holster has no trigger, and riding a socket would move it with every frame of its holder
+		this->StopFiring();
+		DetachFromActor(FDetachmentTransformRules::KeepWorldTransform);
+	}
+
+	// Nothing animates a weapon nobody sees
+	this->WeaponMesh->bNoSkeletonUpdate = bNewHolstered;
+	this->WeaponMesh->SetComponentTickEnabled(!bNewHolstered);
+
+	if (!bNewHolstered && this->WeaponMesh->SkeletalMesh)
+	{
+		// Our mesh may have ticked already this frame; pose it now so it is right the frame it is taken out
+		this->WeaponMesh->RefreshBoneTransforms();
+	}
+
+	if (this->Role != ROLE_Authority)
+	{
+		return;
+	}
+
+	if (bNewHolstered)
+	{
+		// The channel sends the hidden flag before it goes dormant, then the net driver stops looking at us
+		SetNetDormancy(DORM_DormantAll);
+	}
+	else
+	{
+		// Waking up flushes the dormant channels, whatever changed while holstered goes out on the next net tick
+		SetNetDormancy(DORM_Awake);
+		ForceNetUpdate();
+	}
+}
+
+void ABaseWeapon::OnHitscanResolved(const FHitscanShot& Shot, const FHitResult& HitResult)
+{
+	if (this->OnHitscanResolvedDelegate.IsBound())
+	{
+		this->OnHitscanResolvedDelegate.Broadcast(this, HitResult);
+	}
+}
+
+void ABaseWeapon::QueueHitscanShot(float Timestamp)
+{
+	UWeaponHitscanManager* HitscanManager = UWeaponHitscanManager::Get(GetWorld());
+	if (HitscanManager == nullptr)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("QueueHitscanShot:: there is no hitscan manager in this world"))
+		return;
+	}
+
+	FVector ViewLocation;
+	FRotator ViewRotation;
+	this->GetAimViewPoint(ViewLocation, ViewRotation);
+
+	const FVector AimDirection = ViewRotation.Vector();
+	const float SpreadHalfAngle = FMath::DegreesToRadians(this->PelletSpreadAngle);
+
+	for (int32 Pellet = 0; Pellet < this->PelletsPerShot; ++Pellet)
+	{
+		const FVector PelletDirection = SpreadHalfAngle > 0.0f ? FMath::VRandCone(AimDirection, SpreadHalfAngle) : AimDirection;
+		HitscanManager->QueueShot(this, ViewLocation, ViewLocation + PelletDirection * this->HitscanRange, this->HitscanChannel, Timestamp);
+	}
+}
+
+void ABaseWeapon::LaunchProjectile(float Timestamp)
+{
+	FVector ViewLocation;
+	FRotator ViewRotation;
+	this->GetAimViewPoint(ViewLocation, ViewRotation);
+
+	// Launch from the muzzle towards whatever the owner is looking at
+	const FVector MuzzleLocation = this->WeaponMesh->DoesSocketExist(this->MuzzleSocketName) ? this->WeaponMesh->GetSocketLocation(this->MuzzleSocketName) : GetActorLocation();
+	const FVector AimTarget = ViewLocation + ViewRotation.Vector() * this->HitscanRange;
+	const FTransform LaunchTransform((AimTarget - MuzzleLocation).Rotation(), MuzzleLocation);
+
+	APawn* InstigatorPawn = Cast<APawn>(GetOwner());
+
+	// A shot fired earlier, between two frames or by a lagging client, starts as far along as it would be by now
+	const float CatchUpTime = FMath::Max(GetWorld()->GetTimeSeconds() - Timestamp, 0.0f);
+
+	UProjectilePool* ProjectilePool = UProjectilePool::Get(GetWorld());
+	if (ProjectilePool)
+	{
+		ProjectilePool->Acquire(this->ProjectileClass, LaunchTransform, GetOwner(), InstigatorPawn, CatchUpTime);
+		return;
+	}
+
+	UE_LOG(LogTemp, Warning, TEXT("LaunchProjectile:: there is no projectile pool in this world, spawning directly"))
+
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	ABaseProjectile* Projectile = GetWorld()->SpawnActor<ABaseProjectile>(this->ProjectileClass, LaunchTransform, SpawnParameters);
+	if (Projectile)
+	{
+		Projectile->ActivateFromPool(LaunchTransform, GetOwner(), InstigatorPawn, CatchUpTime);
+	}
+}
+
+const FWeaponStats* ABaseWeapon::GetCatalogStats() const
+{
+	if (this->WeaponCatalog == nullptr)
+	{
+		return nullptr;
+	}
+
+	// Rows added or removed by a rebake shift the indices; find ours again by id
+	if (this->CatalogBakeVersion != this->WeaponCatalog->GetBakeVersion())
+	{
+		this->CatalogIndex = this->WeaponCatalog->FindWeaponIndex(this->WeaponId);
+		this->CatalogBakeVersion = this->WeaponCatalog->GetBakeVersion();
+	}
+
+	return this->WeaponCatalog->GetStats(this->CatalogIndex);
+}
+
+void ABaseWeapon::ResolveCatalogIndex()
+{
+	this->WeaponCatalog = nullptr;
+	this->CatalogIndex = INDEX_NONE;
+
+	if (this->WeaponId.IsNone())
+	{
+		return;
+	}
+
+	UWeaponCatalog* Catalog = UWeaponCatalog::Get(GetWorld());
+	if (Catalog == nullptr)
+	{
+		return;
+	}
+
+	// Keep the catalog even if the id is missing, a rebake may add its row
+	this->WeaponCatalog = Catalog;
+	this->CatalogIndex = Catalog->FindWeaponIndex(this->WeaponId);
+	this->CatalogBakeVersion = Catalog->GetBakeVersion();
+
+	if (this->CatalogIndex == INDEX_NONE)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("ResolveCatalogIndex:: %s is not in the weapon catalog, using the weapon's own stats"), *this->WeaponId.ToString())
+	}
+}
+
+void ABaseWeapon::GetAimViewPoint(FVector& ViewLocation, FRotator& ViewRotation) const
+{
+	// Aim from the eyes of whoever holds the weapon, or from the weapon itself
+	AActor* WeaponOwner = GetOwner();
+	if (WeaponOwner)
+	{
+		WeaponOwner->GetActorEyesViewPoint(ViewLocation, ViewRotation);
+	}
+	else
+	{
+		ViewLocation = GetActorLocation();
+		ViewRotation = GetActorRotation();
+	}
+}
+
 ABaseWeapon::ABaseWeapon()
 {
- 	// Set this actor to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
+ 	// Weapons only tick while the trigger of an automatic weapon is held
 	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bStartWithTickEnabled = false;
 
 	USceneComponent* SceneComponent = CreateDefaultSubobject<USceneComponent>(TEXT("RootComponent"));
 	RootComponent = SceneComponent;
 
 	this->WeaponMesh = CreateDefaultSubobject<USkeletalMeshComponent>(TEXT("WeaponMesh"));
+
+	// Only visibility and ownership change once a weapon is held, its ammo replicates through the holder
+	bReplicates = true;
+	NetUpdateFrequency = 2.0f;
+
+	// A held weapon is relevant exactly when its holder is; holstered ones go dormant on top of that
+	bNetUseOwnerRelevancy = true;
 }
 
 void ABaseWeapon::BeginPlay()
 {
 	Super::BeginPlay();
 
-	// We are starting with full loading magazine
-	this->CurrentAmmoInMag = this->MaxAmmoInMag;
-	// and backpack filled with ammo
-	this->CurrentAmmoInBackpack = this->MaxAmmoInBackpack;
+	this->ResetWeaponState();
+}
+
+void ABaseWeapon::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	UWeaponStateStore* StateStore = UWeaponStateStore::Get(GetWorld());
+	if (StateStore && StateStore->IsValidAgent(this->StateStoreHandle))
+	{
+		StateStore->RemoveAgent(this->StateStoreHandle);
+	}
+	this->StateStoreHandle = INDEX_NONE;
+
+	Super::EndPlay(EndPlayReason);
 }
 
 void ABaseWeapon::Tick(float DeltaTime)
 {
 	Super::Tick(DeltaTime);
+
+	if (!this->bTriggerHeld || !this->bIsAutomatic)
+	{
+		return;
+	}
+
+	// Emit every shot that fell into this frame, however long the frame was
+	const float FireInterval = this->GetFireInterval();
+	const float FrameEndTime = GetWorld()->GetTimeSeconds();
+
+	this->FireAccumulator += DeltaTime;
+
+	while (this->FireAccumulator >= FireInterval)
+	{
+		this->FireAccumulator -= FireInterval;
+
+		// What is left in the accumulator is how long before the end of the frame this shot happened
+		if (!this->FireTriggerShot(FrameEndTime - this->FireAccumulator))
+		{
+			// Empty or busy; do not bank the time for a burst once we can fire again
+			this->FireAccumulator = 0.0f;
+			break;
+		}
+	}
 }
 
@@ -0,0 +1,100 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "DebugTelemetry.h"
+
+#if SHOOTER_DEBUG_TELEMETRY
+
+#include "HAL/IConsoleManager.h"
+#include "Engine/Canvas.h"
+#include "Engine/Engine.h"
+
+static TAutoConsoleVariable<int32> CVarDebugTelemetry(
+	TEXT("Shooter.DebugTelemetry"),
+	0,
+	TEXT("If 1, input values are recorded into the debug telemetry channel and drawn by the HUD."),
+	ECVF_Cheat);
+
+/* Display names, indexed by EDebugTelemetryChannel */
+static const TCHAR* DebugTelemetryChannelNames[EDebugTelemetryChannel::Num] =
+{
+	TEXT("MouseX"),
+	TEXT("MouseY"),
+};
+
+FDebugTelemetrySample FDebugTelemetry::Samples[FDebugTelemetry::Capacity];
+int32 FDebugTelemetry::Head = 0;
+int32 FDebugTelemetry::NumSamples = 0;
+
+bool FDebugTelemetry::IsEnabled()
+{
+	return CVarDebugTelemetry.GetValueOnGameThread() != 0;
+}
+
+void FDebugTelemetry::Record(EDebugTelemetryChannel::Type Channel, float Value)
+{
+	if (!IsEnabled())
+	{
+		return;
+	}
+
+	FDebugTelemetrySample& Sample = Samples[Head];
+	Sample.Time = (float)FPlatformTime::Seconds();
+	Sample.Value = Value;
+	Sample.Channel = Channel;
+
+	Head = (Head + 1) % Capacity;
+	NumSamples = FMath::Min(NumSamples + 1, Capacity);
+}
+
+void FDebugTelemetry::Draw(UCanvas* Canvas, float X, float Y)
+{
+	if (!IsEnabled() || Canvas == nullptr || GEngine == nullptr)
+	{
+		return;
+	}
+
+	UFont* Font = GEngine->GetSmallFont();
+	const float LineHeight = 14.0f;
+	const float Now = (float)FPlatformTime::Seconds();
+
+	for (int32 Channel = 0; Channel < EDebugTelemetryChannel::Num; ++Channel)
+	{
+		// Walk back from the newest sample, summarising the last second of this channel
+		float Latest = 0.0f;
+		float Min = MAX_flt;
+		float Max = -MAX_flt;
+		int32 Count = 0;
+
+		for (int32 Age = 0; Age < NumSamples; ++Age)
+		{
+			const FDebugTelemetrySample& Sample = Samples[(Head - 1 - Age + Capacity) % Capacity];
+			if (Now - Sample.Time > 1.0f)
+			{
+				break;
+			}
+
+			if (Sample.Channel != Channel)
+			{
+				continue;
+			}
+
+			if (Count == 0)
+			{
+				Latest = Sample.Value;
+			}
+
+			Min = FMath::Min(Min, Sample.Value);
+			Max = FMath::Max(Max, Sample.Value);
+			++Count;
+		}
+
+		const FString Line = Count > 0
+			? FString::Printf(TEXT("%s: %.3f  [%.3f, %.3f]  %d/s"), DebugTelemetryChannelNames[Channel], Latest, Min, Max, Count)
+			: FString::Printf(TEXT("%s: -"), DebugTelemetryChannelNames[Channel]);
+
+		Canvas->SetDrawColor(FColor::Yellow);
+		Canvas->DrawText(Font, Line, X, Y + Channel * LineHeight);
+	}
+}
+
+#endif
@@ -0,0 +1,130 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "GameplayCharacterAnimInstance.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "GameplayPlayerCharacter.h"
+#include "ShooterTutorial.h"
+
+DECLARE_CYCLE_STAT(TEXT("Character Anim PreUpdate"), STAT_ShooterAnimPreUpdate, STATGROUP_ShooterTutorial);
+DECLARE_CYCLE_STAT(TEXT("Character Anim Update"), STAT_ShooterAnimUpdate, STATGROUP_ShooterTutorial);
+
+FGameplayCharacterAnimInstanceProxy::FGameplayCharacterAnimInstanceProxy(UAnimInstance* InAnimInstance)
+	: FAnimInstanceProxy(InAnimInstance)
+	, Instance(nullptr)
+	, Velocity(ForceInitToZero)
+	, ActorRotation(ForceInitToZero)
+	, AimRotation(ForceInitToZero)
+	, WeaponPullDownPercent(0.0f)
+	, bIsFalling(false)
+	, bIsReloading(false)
+	, bIsChangingWeapon(false)
+	, RunSpeedThreshold(0.0f)
+	, MaxAimPitch(90.0f)
+	, MaxAimYaw(90.0f)
+	, WeaponDownOffset(ForceInitToZero)
+{
+}
+
+void FGameplayCharacterAnimInstanceProxy::Initialize(UAnimInstance* InAnimInstance)
+{
+	FAnimInstanceProxy::Initialize(InAnimInstance);
+
+	this->Instance = Cast<UGameplayCharacterAnimInstance>(InAnimInstance);
+}
+
+void FGameplayCharacterAnimInstanceProxy::PreUpdate(UAnimInstance* InAnimInstance, float DeltaSeconds)
+{
+	SCOPE_CYCLE_COUNTER(STAT_ShooterAnimPreUpdate);
+
+	FAnimInstanceProxy::PreUpdate(InAnimInstance, DeltaSeconds);
+
+	if (this->Instance)
+	{
+		this->RunSpeedThreshold = this->Instance->RunSpeedThreshold;
+		this->MaxAimPitch = FMath::Max(this->Instance->MaxAimPitch, 1.0f);
+		this->MaxAimYaw = FMath::Max(this->Instance->MaxAimYaw, 1.0f);
+		this->WeaponDownOffset = this->Instance->WeaponDownOffset;
+	}
+
+	// In the editor preview there is nobody to copy from; keep the last state
+	AGameplayPlayerCharacter* Character = Cast<AGameplayPlayerCharacter>(InAnimInstance->TryGetPawnOwner());
+	if (Character == nullptr)
+	{
+		return;
+	}
+
+	this->Velocity = Character->GetVelocity();
+	this->ActorRotation = Character->GetActorRotation();
+	this->AimRotation = Character->GetBaseAimRotation();
+	this->WeaponPullDownPercent = Character->WeaponPullDownPercent;
+	this->bIsReloading = Character->bIsReloading;
+	this->bIsChangingWeapon = Character->bIsChangingWeapon;
+
+	UCharacterMovementComponent* Movement = Character->GetCharacterMovement();
+	this->bIsFalling = Movement && Movement->IsFalling();
+}
+
+void FGameplayCharacterAnimInstanceProxy::Update(float DeltaSeconds)
+{
+	SCOPE_CYCLE_COUNTER(STAT_ShooterAnimUpdate);
+
+	FAnimInstanceProxy::Update(DeltaSeconds);
+
+	FGameplayCharacterAnimValues& Values = this->AnimValues;
+
+	// Locomotion, in the character's frame
+	const FVector LocalVelocity = this->ActorRotation.UnrotateVector(this->Velocity);
+	Values.Speed = LocalVelocity.Size2D();
+	Values.Direction = Values.Speed > KINDA_SMALL_NUMBER ? FMath::RadiansToDegrees(FMath::Atan2(LocalVelocity.Y, LocalVelocity.X)) : 0.0f;
+	Values.bIsInAir = this->bIsFalling;
+	Values.bIsRunning = !this->bIsFalling && Values.Speed > this->RunSpeedThreshold;
+
+	// Aim, relative to where the character faces; one pose of each pair is blended in at a time
+	const FRotator AimDelta = (this->AimRotation - this->ActorRotation).GetNormalized();
+	Values.AimPitch = FMath::Clamp(AimDelta.Pitch, -this->MaxAimPitch, this->MaxAimPitch);
+	Values.AimYaw = FMath::Clamp(AimDelta.Yaw, -this->MaxAimYaw, this->MaxAimYaw);
+	Values.AimOffsetUpWeight = FMath::Max(Values.AimPitch, 0.0f) / this->MaxAimPitch;
+	Values.AimOffsetDownWeight = FMath::Max(-Values.AimPitch, 0.0f) / this->MaxAimPitch;
+	Values.AimOffsetRightWeight = FMath::Max(Values.AimYaw, 0.0f) / this->MaxAimYaw;
+	Values.AimOffsetLeftWeight = FMath::Max(-Values.AimYaw, 0.0f) / this->MaxAimYaw;
+
+	// Weapon
+	Values.WeaponPullDownPercent = FMath::Clamp(this->WeaponPullDownPercent, 0.0f, 1.0f);
+	Values.HandsOffset = this->WeaponDownOffset * Values.WeaponPullDownPercent;
+	Values.bIsReloading = this->bIsReloading;
+	Values.bIsChangingWeapon = this->bIsChangingWeapon;
+}
+
+void FGameplayCharacterAnimInstanceProxy::PostUpdate(UAnimInstance* InAnimInstance) const
+{
+	FAnimInstanceProxy::PostUpdate(InAnimInstance);
+
+	// Back on the game thread; the update that wrote the values is done
+	if (UGameplayCharacterAnimInstance* AnimInstance = Cast<UGameplayCharacterAnimInstance>(InAnimInstance))
+	{
+		AnimInstance->AnimValues = this->AnimValues;
+	}
+}
+
+void UGameplayCharacterAnimInstance::NativeInitializeAnimation()
+{
+	Super::NativeInitializeAnimation();
+
+	AGameplayPlayerCharacter* Character = Cast<AGameplayPlayerCharacter>(TryGetPawnOwner());
+	this->bIsFirstPersonMesh = Character && GetSkelMeshComponent() == Character->FPPMesh;
+}
+
+FGameplayCharacterAnimValues UGameplayCharacterAnimInstance::GetAnimValues() const
+{
+	return GetProxyOnAnyThread<FGameplayCharacterAnimInstanceProxy>().GetAnimValues();
+}
+
+FAnimInstanceProxy* UGameplayCharacterAnimInstance::CreateAnimInstanceProxy()
+{
+	return new FGameplayCharacterAnimInstanceProxy(this);
+}
+
+void UGameplayCharacterAnimInstance::DestroyAnimInstanceProxy(FAnimInstanceProxy* InProxy)
+{
+	delete InProxy;
+}
@@ -1,6 +1,9 @@
 // Fill out your copyright notice in the Description page of Project Settings.
 
 #include "GameplayGameMode.h"
+#include "Engine/NetDriver.h"
+#include "Engine/NetConnection.h"
+#include "TimerManager.h"
 
 
 // Set default values
@@ -9,4 +12,55 @@ AGameplayGameMode::AGameplayGameMode()
 	this->GameStateClass = AGameplayGameState::StaticClass();
 	this->PlayerControllerClass = AGameplayPlayerController::StaticClass();
 	this->HUDClass = AGameplayHUD::StaticClass();
+	this->SoakDriverClass = AShooterSoakDriver::StaticClass();
+}
+
+void AGameplayGameMode::StartPlay()
+{
+	Super::StartPlay();
+
+	// Soak runs work on any map, no dedicated level is needed
+	if (this->SoakDriverClass && AShooterSoakDriver::IsRequestedOnCommandLine())
+	{
+		FActorSpawnParameters SpawnParameters;
+		SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+		GetWorld()->SpawnActor<AShooterSoakDriver>(this->SoakDriverClass, FTransform::Identity, SpawnParameters);
+	}
+}
+
+void AGameplayGameMode::ShooterNetStats(float RepeatSeconds)
+{
+	GetWorldTimerManager().ClearTimer(this->NetStatsTimerHandle);
+
+	this->LogNetStats();
+
+	if (RepeatSeconds > 0.0f)
+	{
+		GetWorldTimerManager().SetTimer(this->NetStatsTimerHandle, this, &AGameplayGameMode::LogNetStats, RepeatSeconds, true);
+	}
+}
+
+void AGameplayGameMode::LogNetStats()
+{
+	UNetDriver* NetDriver = GetWorld()->GetNetDriver();
+	if (NetDriver == nullptr)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("ShooterNetStats:: this world is not networked, open the map with ?listen"))
+		return;
+	}
+
+	// The connections refresh these rates once a second
+	for (UNetConnection* Connection : NetDriver->ClientConnections)
+	{
+		if (Connection == nullptr)
+		{
+			continue;
+		}
+
+		UE_LOG(LogTemp, Log, TEXT("ShooterNetStats:: %s out %d B/s (%d packets/s) in %d B/s (%d packets/s)"),
+			*GetNameSafe(Connection->PlayerController),
+			Connection->OutBytesPerSecond, Connection->OutPacketsPerSecond,
+			Connection->InBytesPerSecond, Connection->InPacketsPerSecond)
+	}
 }
@@ -1,3 +1,27 @@
 // Fill out your copyright notice in the Description page of Project Settings.
 
-#include "GameplayGameState.h"
\ No newline at end of file
+#include "GameplayGameState.h"
+
+void AGameplayGameState::PostInitializeComponents()
+{
+	Super::PostInitializeComponents();
+
+	// Managers are owned by the game state so there is exactly one per world
+	this->HitscanManager = NewObject<UWeaponHitscanManager>(this);
+	this->ProjectilePool = NewObject<UProjectilePool>(this);
+	this->WeaponPool = NewObject<UWeaponPool>(this);
+	this->WeaponTimelineScheduler = NewObject<UWeaponTimelineScheduler>(this);
+	this->WeaponStateStore = NewObject<UWeaponStateStore>(this);
+	this->LagCompensationManager = NewObject<ULagCompensationManager>(this);
+}
+
+void AGameplayGameState::BeginPlay()
+{
+	Super::BeginPlay();
+
+	// Pay for every projectile spawn now rather than in the middle of a fight
+	for (const auto& Pair : this->ProjectilePoolSizes)
+	{
+		this->ProjectilePool->Prewarm(Pair.Key, Pair.Value);
+	}
+}
@@ -1,7 +1,13 @@
 // Fill out your copyright notice in the Description page of Project Settings.
 
 #include "GameplayHUD.h"
+#include "DebugTelemetry.h"
 
+void AGameplayHUD::DrawHUD()
+{
+	Super::DrawHUD();
 
-
-
+#if SHOOTER_DEBUG_TELEMETRY
+	FDebugTelemetry::Draw(Canvas, 50.0f, 50.0f);
+#endif
+}
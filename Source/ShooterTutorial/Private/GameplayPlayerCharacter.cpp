@@ -2,11 +2,36 @@
 
 #include "GameplayPlayerCharacter.h"
 #include "Runtime/Engine/Classes/Components/CapsuleComponent.h"
+#include "WeaponPool.h"
+#include "Engine/StreamableManager.h"
+#include "ShooterTutorial.h"
+#include "UnrealNetwork.h"
+#include "LagCompensationManager.h"
+#include "GameFramework/GameStateBase.h"
+#include "GameplayCharacterAnimInstance.h"
+
+DECLARE_CYCLE_STAT(TEXT("Character FireWeapon"), STAT_ShooterFireWeapon, STATGROUP_ShooterTutorial);
+DECLARE_CYCLE_STAT(TEXT("Character ReloadWeapon"), STAT_ShooterReloadWeapon, STATGROUP_ShooterTutorial);
+DECLARE_CYCLE_STAT(TEXT("Character EquipWeapon"), STAT_ShooterEquipWeapon, STATGROUP_ShooterTutorial);
+DECLARE_CYCLE_STAT(TEXT("Character SpawnWeapons"), STAT_ShooterSpawnWeapons, STATGROUP_ShooterTutorial);
+DECLARE_CYCLE_STAT(TEXT("Character Timeline Handlers"), STAT_ShooterTimelineHandlers, STATGROUP_ShooterTutorial);
+DECLARE_DWORD_COUNTER_STAT(TEXT("FireWeapon Calls"), STAT_ShooterFireWeaponCalls, STATGROUP_ShooterTutorial);
+DECLARE_DWORD_COUNTER_STAT(TEXT("ReloadWeapon Calls"), STAT_ShooterReloadWeaponCalls, STATGROUP_ShooterTutorial);
+DECLARE_DWORD_COUNTER_STAT(TEXT("EquipWeapon Calls"), STAT_ShooterEquipWeaponCalls, STATGROUP_ShooterTutorial);
+DECLARE_DWORD_COUNTER_STAT(TEXT("SpawnWeapons Calls"), STAT_ShooterSpawnWeaponsCalls, STATGROUP_ShooterTutorial);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Timeline Handler Calls"), STAT_ShooterTimelineHandlerCalls, STATGROUP_ShooterTutorial);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Weapon Ammo Mispredictions"), STAT_ShooterWeaponMispredictions, STATGROUP_ShooterTutorial);
+
+/* How many unacknowledged actions the owning client remembers; older ones are given up on */
+static const int32 MaxPendingWeaponActions = 64;
+
+/* How much sooner than the fire interval the server still takes a shot, for drift in the client's clock offset */
+static const float ServerFireIntervalTolerance = 0.02f;
 
 AGameplayPlayerCharacter::AGameplayPlayerCharacter()
 {
- 	// Set this character to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
-	PrimaryActorTick.bCanEverTick = true;
+ 	// Weapon timelines are advanced by the world's UWeaponTimelineScheduler, so this character does not need to tick
+	PrimaryActorTick.bCanEverTick = false;
 
 	// Create the camera component
 	this->Camera = CreateDefaultSubobject<UCameraComponent>(TEXT("Camera"));
@@ -20,11 +45,480 @@ AGameplayPlayerCharacter::AGameplayPlayerCharacter()
 	// Attach this mesh to camera component
 	FAttachmentTransformRules FPPMeshAttachmentRules(EAttachmentRule::SnapToTarget, false);
 	this->FPPMesh->AttachToComponent(this->Camera, FPPMeshAttachmentRules);
+
+	// Create the backpack inventory component
+	this->BackpackInventory = CreateDefaultSubobject<UBackpackInventoryComponent>(TEXT("BackpackInventory"));
+
+	// Nothing can be fired until a weapon is held
+	this->MirrorWeaponActionState();
+}
+
+void AGameplayPlayerCharacter::PostInitializeComponents()
+{
+	Super::PostInitializeComponents();
+
+	// The anim blueprints can be children of UGameplayCharacterAnimInstance without touching the meshes
+	if (this->FPPAnimClass && this->FPPMesh)
+	{
+		this->FPPMesh->SetAnimInstanceClass(this->FPPAnimClass);
+	}
+
+	if (this->TPPAnimClass && GetMesh())
+	{
+		GetMesh()->SetAnimInstanceClass(this->TPPAnimClass);
+	}
+
+	this->BackpackInventory->OnItemsChangedDelegate.AddUObject(this, &AGameplayPlayerCharacter::OnBackpackItemsChanged);
+	this->BackpackInventory->SetItems(this->BackpackWeapons);
+}
+
+void AGameplayPlayerCharacter::OnBackpackItemsChanged(int32 ItemIndex)
+{
+	// Widgets bind to BackpackWeapons, so it follows every change of the inventory
+	if (ItemIndex != INDEX_NONE && this->BackpackWeapons.Num() == this->BackpackInventory->GetNumItems())
+	{
+		// A single item only ever changes its selection and slot
+		const FWeaponBackpackItem& Item = this->BackpackInventory->GetItem(ItemIndex);
+		this->BackpackWeapons[ItemIndex].bIsSelected = Item.bIsSelected;
+		this->BackpackWeapons[ItemIndex].InSlot = Item.InSlot;
+		return;
+	}
+
+	this->BackpackWeapons = this->BackpackInventory->GetItems();
+
+	// Items may have moved to other indices; the slots still know which item each weapon came from
+	ABaseWeapon* SlotWeapons[] = { this->WeaponSlot1, this->WeaponSlot2, this->WeaponSlot3 };
+	for (int32 Slot = 1; Slot <= 3; ++Slot)
+	{
+		ABaseWeapon* SlotWeapon = SlotWeapons[Slot - 1];
+		if (SlotWeapon == nullptr)
+		{
+			continue;
+		}
+
+		// A weapon whose item left the backpack, or whose slot now holds another weapon, has no item until the next loadout
+		const int32 ItemIndex = this->BackpackInventory->GetItemInSlot(Slot);
+		const bool bSameWeapon = ItemIndex != INDEX_NONE && this->BackpackInventory->GetItem(ItemIndex).WeaponToSpawnAsset.ToStringReference() == FStringAssetReference(SlotWeapon->GetClass());
+		SlotWeapon->IndexInBackpack = bSameWeapon ? ItemIndex : INDEX_NONE;
+	}
+}
+
+void AGameplayPlayerCharacter::PostLoad()
+{
+	Super::PostLoad();
+
+	// Backpacks saved with hard references move to the soft ones; the deprecated fields are never saved back
+	for (FWeaponBackpackItem& Item : this->BackpackWeapons)
+	{
+		Item.MigrateToSoftReferences();
+	}
+}
+
+void AGameplayPlayerCharacter::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	// Everybody sees which weapon we hold and how it moves, only we need the other slots
+	DOREPLIFETIME(AGameplayPlayerCharacter, CurrentWeapon);
+	DOREPLIFETIME_CONDITION(AGameplayPlayerCharacter, WeaponSlot1, COND_OwnerOnly);
+	DOREPLIFETIME_CONDITION(AGameplayPlayerCharacter, WeaponSlot2, COND_OwnerOnly);
+	DOREPLIFETIME_CONDITION(AGameplayPlayerCharacter, WeaponSlot3, COND_OwnerOnly);
+
+	DOREPLIFETIME(AGameplayPlayerCharacter, ReplicatedWeaponState);
+	DOREPLIFETIME_CONDITION(AGameplayPlayerCharacter, WeaponActionAck, COND_OwnerOnly);
+}
+
+void AGameplayPlayerCharacter::PreReplication(IRepChangedPropertyTracker& ChangedPropertyTracker)
+{
+	Super::PreReplication(ChangedPropertyTracker);
+
+	// Packed once per net update instead of marking every place that touches these flags
+	this->ReplicatedWeaponState.ActionState = (uint8)this->WeaponActionStateMachine.GetState();
+	this->ReplicatedWeaponState.WeaponPullDown = (uint8)FMath::RoundToInt(FMath::Clamp(this->WeaponPullDownPercent, 0.0f, 1.0f) * 255.0f);
+	this->ReplicatedWeaponState.BurstCounter = this->BurstCounter;
+
+	// All received actions were processed before this, so the ammo is exactly what they left
+	this->WeaponActionAck.Sequence = this->LastProcessedWeaponAction;
+
+	ABaseWeapon* Slots[] = { this->WeaponSlot1, this->WeaponSlot2, this->WeaponSlot3 };
+	for (int32 SlotIndex = 0; SlotIndex < ARRAY_COUNT(Slots); ++SlotIndex)
+	{
+		this->WeaponActionAck.SlotAmmo[SlotIndex].AmmoInMag = Slots[SlotIndex] ? Slots[SlotIndex]->CurrentAmmoInMag : 0;
+		this->WeaponActionAck.SlotAmmo[SlotIndex].AmmoInBackpack = Slots[SlotIndex] ? Slots[SlotIndex]->CurrentAmmoInBackpack : 0;
+	}
+}
+
+void AGameplayPlayerCharacter::OnRep_CurrentWeapon(ABaseWeapon* PreviousWeapon)
+{
+	if (this->CurrentWeapon == nullptr)
+	{
+		return;
+	}
+
+	// The server has not seen our latest equip yet; its older choice would undo it, so it waits for the acknowledgement
+	if (IsLocallyControlled() && this->HasPendingWeaponAction(EWeaponActionType::WAT_Equip))
+	{
+		this->DeferredCurrentWeapon = this->CurrentWeapon;
+		this->CurrentWeapon = PreviousWeapon;
+		return;
+	}
+
+	this->DeferredCurrentWeapon.Reset();
+	this->ApplyReplicatedCurrentWeapon(PreviousWeapon);
+}
+
+void AGameplayPlayerCharacter::ApplyReplicatedCurrentWeapon(ABaseWeapon* PreviousWeapon)
+{
+	// The owner fires through the trigger binding, so move it over the way SetCurrentWeapon does
+	if (IsLocallyControlled())
+	{
+		ABaseWeapon* NewWeapon = this->CurrentWeapon;
+		this->CurrentWeapon = PreviousWeapon;
+		this->SetCurrentWeapon(NewWeapon);
+	}
+
+	if (this->IsSlotWeapon(this->CurrentWeapon))
+	{
+		this->ShowCurrentWeapon(this->CurrentWeapon);
+		return;
+	}
+
+	// Other players never receive our slots, and the owner may get the weapon before them; show it on its own
+	if (PreviousWeapon && PreviousWeapon != this->CurrentWeapon)
+	{
+		PreviousWeapon->SetHolstered(true);
+	}
+
+	this->CurrentWeapon->SetHolstered(false);
+	this->AttachWeaponToFPPMesh(this->CurrentWeapon);
+}
+
+void AGameplayPlayerCharacter::OnRep_WeaponSlots()
+{
+	// Holstered weapons stay detached until they are shown
+	ABaseWeapon* Slots[] = { this->WeaponSlot1, this->WeaponSlot2, this->WeaponSlot3 };
+	for (ABaseWeapon* SlotWeapon : Slots)
+	{
+		if (SlotWeapon && !SlotWeapon->IsHolstered())
+		{
+			this->AttachWeaponToFPPMesh(SlotWeapon);
+		}
+	}
+}
+
+void AGameplayPlayerCharacter::OnRep_WeaponState()
+{
+	// The owner plays its own shots and timelines ahead of the server
+	if (IsLocallyControlled())
+	{
+		this->BurstCounter = this->ReplicatedWeaponState.BurstCounter;
+		this->bHasReceivedWeaponState = true;
+
+		// Once the server has caught up with everything we predicted its state is the truth
+		if (this->PendingWeaponActions.Num() == 0)
+		{
+			this->WeaponActionStateMachine.SetState((EWeaponActionState)this->ReplicatedWeaponState.ActionState);
+			this->MirrorWeaponActionState();
+		}
+
+		return;
+	}
+
+	this->WeaponActionStateMachine.SetState((EWeaponActionState)this->ReplicatedWeaponState.ActionState);
+	this->MirrorWeaponActionState();
+	this->WeaponPullDownPercent = this->ReplicatedWeaponState.WeaponPullDown / 255.0f;
+
+	// Shots fired before we joined are not played
+	const uint8 NewShots = this->bHasReceivedWeaponState ? (uint8)(this->ReplicatedWeaponState.BurstCounter - this->BurstCounter) : 0;
+	this->BurstCounter = this->ReplicatedWeaponState.BurstCounter;
+	this->bHasReceivedWeaponState = true;
+
+	if (this->CurrentWeapon && this->OnCharacterFireDelegate.IsBound())
+	{
+		for (int32 Shot = 0; Shot < NewShots; ++Shot)
+		{
+			this->OnCharacterFireDelegate.Broadcast(this->CurrentWeapon->GetWeaponType());
+		}
+	}
+}
+
+void AGameplayPlayerCharacter::OnRep_WeaponActionAck()
+{
+	// Whatever the server processed is settled, whether it agreed or not
+	const uint16 AckedSequence = this->WeaponActionAck.Sequence;
+	this->PendingWeaponActions.RemoveAll([AckedSequence](const FPredictedWeaponAction& Action)
+	{
+		return !FWeaponActionAck::IsNewer(Action.Sequence, AckedSequence);
+	});
+
+	// The server's weapon that waited for our equips; it stands unless we already hold it
+	ABaseWeapon* DeferredWeapon = this->DeferredCurrentWeapon.Get();
+	if (DeferredWeapon && !this->HasPendingWeaponAction(EWeaponActionType::WAT_Equip))
+	{
+		this->DeferredCurrentWeapon.Reset();
+		if (DeferredWeapon != this->CurrentWeapon)
+		{
+			ABaseWeapon* PreviousWeapon = this->CurrentWeapon;
+			this->CurrentWeapon = DeferredWeapon;
+			this->ApplyReplicatedCurrentWeapon(PreviousWeapon);
+		}
+	}
+
+	// Start over from the server's ammo and apply what it has not seen yet
+	ABaseWeapon* Slots[] = { this->WeaponSlot1, this->WeaponSlot2, this->WeaponSlot3 };
+	for (int32 SlotIndex = 0; SlotIndex < ARRAY_COUNT(Slots); ++SlotIndex)
+	{
+		ABaseWeapon* SlotWeapon = Slots[SlotIndex];
+		if (SlotWeapon == nullptr)
+		{
+			continue;
+		}
+
+		int32 AmmoInMag = this->WeaponActionAck.SlotAmmo[SlotIndex].AmmoInMag;
+		int32 AmmoInBackpack = this->WeaponActionAck.SlotAmmo[SlotIndex].AmmoInBackpack;
+
+		for (const FPredictedWeaponAction& Action : this->PendingWeaponActions)
+		{
+			if (Action.Weapon.Get() != SlotWeapon || !Action.bApplied)
+			{
+				continue;
+			}
+
+			if (Action.Type == EWeaponActionType::WAT_Fire && AmmoInMag > 0)
+			{
+				AmmoInMag--;
+			}
+			else if (Action.Type == EWeaponActionType::WAT_Reload)
+			{
+				// Same rule as ABaseWeapon::Reload
+				const int32 MinAmmo = FMath::Min<int32>(AmmoInBackpack, SlotWeapon->GetMaxAmmoInMag());
+				AmmoInMag = MinAmmo;
+				AmmoInBackpack -= MinAmmo;
+			}
+		}
+
+		if (SlotWeapon->CurrentAmmoInMag != AmmoInMag || SlotWeapon->CurrentAmmoInBackpack != AmmoInBackpack)
+		{
+			INC_DWORD_STAT(STAT_ShooterWeaponMispredictions);
+
+			SlotWeapon->CurrentAmmoInMag = AmmoInMag;
+			SlotWeapon->CurrentAmmoInBackpack = AmmoInBackpack;
+		}
+	}
+}
+
+bool AGameplayPlayerCharacter::HasPendingWeaponAction(EWeaponActionType Type) const
+{
+	return this->PendingWeaponActions.ContainsByPredicate([Type](const FPredictedWeaponAction& Action)
+	{
+		return Action.Type == Type;
+	});
+}
+
+uint16 AGameplayPlayerCharacter::RecordWeaponAction(EWeaponActionType Type, ABaseWeapon* Weapon)
+{
+	// A server that never answers should not make us remember every shot
+	if (this->PendingWeaponActions.Num() >= MaxPendingWeaponActions)
+	{
+		this->PendingWeaponActions.RemoveAt(0, 1, false);
+	}
+
+	this->WeaponActionSequence++;
+	this->PendingWeaponActions.Add(FPredictedWeaponAction(this->WeaponActionSequence, Type, Weapon));
+
+	return this->WeaponActionSequence;
+}
+
+void AGameplayPlayerCharacter::AcknowledgeWeaponAction(uint16 Sequence)
+{
+	if (FWeaponActionAck::IsNewer(Sequence, this->LastProcessedWeaponAction))
+	{
+		this->LastProcessedWeaponAction = Sequence;
+	}
+
+	ForceNetUpdate();
+}
+
+void AGameplayPlayerCharacter::ServerFireWeapon_Implementation(uint16 Sequence, float ServerTime)
+{
+	// Only the latest shot is buffered, like the client's press; an older one is answered as dropped
+	if (this->PendingServerFire != INDEX_NONE)
+	{
+		this->AcknowledgeWeaponAction((uint16)this->PendingServerFire);
+	}
+
+	this->PendingServerFire = Sequence;
+	this->PendingServerFireTime = ServerTime;
+
+	// A shot that arrives while the server is still reloading or equipping waits for it, as it did on the client
+	switch (this->HandleWeaponActionInput(EWeaponActionInput::WAI_Fire))
+	{
+		case EWeaponActionResult::WAR_Execute:
+			this->ExecutePendingServerFire();
+			break;
+
+		case EWeaponActionResult::WAR_Buffer:
+			break;
+
+		default:
+			this->PendingServerFire = INDEX_NONE;
+			this->AcknowledgeWeaponAction(Sequence);
+			break;
+	}
+}
+
+void AGameplayPlayerCharacter::ExecutePendingServerFire()
+{
+	if (this->PendingServerFire == INDEX_NONE)
+	{
+		return;
+	}
+
+	const uint16 Sequence = (uint16)this->PendingServerFire;
+	this->PendingServerFire = INDEX_NONE;
+
+	// The client only sends shots it had ammo for; a shot the server disagrees with is dropped, never turned into a reload
+	if (this->bCanFire && this->CurrentWeapon && this->CurrentWeapon->CurrentAmmoInMag > 0)
+	{
+		// Hit whatever the shooter saw, but never further back than the history allows
+		ULagCompensationManager* LagCompensation = ULagCompensationManager::Get(GetWorld());
+		const float ShotTime = LagCompensation ? LagCompensation->ClampRewindTime(this->PendingServerFireTime) : GetWorld()->GetTimeSeconds();
+
+		// Never faster than the weapon fires; shot times are compared, so shots bunched up by the network still pass
+		if (ShotTime - this->CurrentWeapon->LastAcceptedShotTime >= this->CurrentWeapon->GetFireInterval() - ServerFireIntervalTolerance)
+		{
+			this->CurrentWeapon->LastAcceptedShotTime = ShotTime;
+			this->CurrentWeapon->SetNextShotTimestamp(ShotTime);
+
+			this->FireCurrentWeaponShot();
+		}
+		else
+		{
+			UE_LOG(LogTemp, Warning, TEXT("ExecutePendingServerFire:: shot came sooner than the fire interval of the current weapon"))
+		}
+	}
+
+	this->AcknowledgeWeaponAction(Sequence);
+}
+
+bool AGameplayPlayerCharacter::ServerFireWeapon_Validate(uint16 Sequence, float ServerTime)
+{
+	return true;
+}
+
+void AGameplayPlayerCharacter::ServerReloadWeapon_Implementation(uint16 Sequence)
+{
+	this->PendingServerReload = Sequence;
+	this->ReloadWeapon();
+
+	// No reload was started or is waiting for one to be allowed, so none will finish and acknowledge it
+	if (!this->bIsReloading && !this->WeaponActionStateMachine.IsBuffered(EWeaponActionInput::WAI_Reload) && this->PendingServerReload != INDEX_NONE)
+	{
+		this->PendingServerReload = INDEX_NONE;
+		this->AcknowledgeWeaponAction(Sequence);
+	}
+}
+
+bool AGameplayPlayerCharacter::ServerReloadWeapon_Validate(uint16 Sequence)
+{
+	return true;
+}
+
+void AGameplayPlayerCharacter::ServerEquipWeapon_Implementation(ABaseWeapon* Weapon, uint16 Sequence)
+{
+	// A slot may have changed under a client that has not heard of it yet; refuse the equip, do not kick the client
+	if (!this->IsSlotWeapon(Weapon))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("ServerEquipWeapon:: Weapon is not WeaponSlot1 || WeaponSlot2 || WeaponSlot3"))
+		this->AcknowledgeWeaponAction(Sequence);
+		return;
+	}
+
+	// Already in hand, e.g. the server swapped before the client asked; nothing will play, so answer now
+	if (Weapon == this->CurrentWeapon)
+	{
+		this->AcknowledgeWeaponAction(Sequence);
+		return;
+	}
+
+	this->PendingServerEquip = Sequence;
+	this->EquipWeapon(Weapon);
+
+	// NewWeaponToEquip is only set while an equip plays up to its swap, so anything else is a refusal no weapon down event will answer
+	const bool bEquipStarted = this->NewWeaponToEquip == Weapon;
+	if (!bEquipStarted && !this->WeaponActionStateMachine.IsBuffered(EWeaponActionInput::WAI_Equip) && this->PendingServerEquip != INDEX_NONE)
+	{
+		this->PendingServerEquip = INDEX_NONE;
+		this->AcknowledgeWeaponAction(Sequence);
+	}
+}
+
+bool AGameplayPlayerCharacter::ServerEquipWeapon_Validate(ABaseWeapon* Weapon, uint16 Sequence)
+{
+	return true;
+}
+
+void AGameplayPlayerCharacter::ServerSetBackpackItemSelected_Implementation(int32 BackPackItemIndex, bool bIsSelected, int32 WhichSlot)
+{
+	this->SetBackpackItemSelected(BackPackItemIndex, bIsSelected, WhichSlot);
+}
+
+bool AGameplayPlayerCharacter::ServerSetBackpackItemSelected_Validate(int32 BackPackItemIndex, bool bIsSelected, int32 WhichSlot)
+{
+	return this->BackpackInventory->IsValidItem(BackPackItemIndex) && WhichSlot >= 0 && WhichSlot <= 3;
+}
+
+void AGameplayPlayerCharacter::ServerSpawnWeaponsAndAssignToSlots_Implementation()
+{
+	this->SpawnWeaponsAndAssignToSlots();
+}
+
+bool AGameplayPlayerCharacter::ServerSpawnWeaponsAndAssignToSlots_Validate()
+{
+	return true;
 }
 
 void AGameplayPlayerCharacter::BeginPlay()
 {
 	Super::BeginPlay();
+
+	// Get the loadout's weapon classes streaming before the weapons are spawned
+	this->PrefetchSlottedWeapons();
+
+	// Bake the weapon curves now rather than on the first reload or weapon change
+	UWeaponTimelineScheduler* Scheduler = UWeaponTimelineScheduler::Get(GetWorld());
+	if (Scheduler)
+	{
+		Scheduler->BakeCurve(this->EquipWeaponCurve);
+		Scheduler->BakeCurve(this->WeaponReloadDownCurve);
+		Scheduler->BakeCurve(this->WeaponReloadUpCurve);
+	}
+
+	// The server keeps where we were, so shots can be checked against what their shooter saw
+	ULagCompensationManager* LagCompensation = ULagCompensationManager::Get(GetWorld());
+	if (LagCompensation && HasAuthority() && GetNetMode() != NM_Standalone)
+	{
+		this->LagCompensationHandle = LagCompensation->AddTarget(this);
+	}
+}
+
+void AGameplayPlayerCharacter::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	// A dying or respawning character hands its loadout back to the pool;
+	// on level change or quit the whole world goes away anyway
+	if (EndPlayReason == EEndPlayReason::Destroyed)
+	{
+		this->ReleaseSlotWeapons();
+	}
+
+	ULagCompensationManager* LagCompensation = ULagCompensationManager::Get(GetWorld());
+	if (LagCompensation && LagCompensation->IsValidTarget(this->LagCompensationHandle))
+	{
+		LagCompensation->RemoveTarget(this->LagCompensationHandle);
+	}
+	this->LagCompensationHandle = INDEX_NONE;
+
+	Super::EndPlay(EndPlayReason);
 }
 
 UShooterGameInstance* AGameplayPlayerCharacter::GetShooterGameInstance() const
@@ -40,129 +534,250 @@ void AGameplayPlayerCharacter::SetCurrentWeapon(ABaseWeapon *Weapon)
 		return;
 	}
 
+	// The holstered weapon stops firing and no longer fires through us
+	if (this->CurrentWeapon && this->CurrentWeapon != Weapon)
+	{
+		this->CurrentWeapon->StopFiring();
+		this->CurrentWeapon->OnTriggerShotDelegate.Unbind();
+		this->CurrentWeapon->OnShotEmittedDelegate.Unbind();
+	}
+
 	this->CurrentWeapon = Weapon;
+	this->CurrentWeapon->OnTriggerShotDelegate.BindUObject(this, &AGameplayPlayerCharacter::HandleTriggerShot);
+	this->CurrentWeapon->OnShotEmittedDelegate.BindUObject(this, &AGameplayPlayerCharacter::HandleWeaponShotEmitted);
+
+	// Holding a weapon for the first time makes it ready; during an equip this is just the swap
+	this->HandleWeaponActionInput(EWeaponActionInput::WAI_Armed);
 }
 
 bool AGameplayPlayerCharacter::CanAddWeaponToWeaponSelected(int32& HowManyItemsSelected)
 {
-	if (this->BackpackWeapons.Num() <= 0)
+	if (this->BackpackInventory->GetNumItems() <= 0)
 	{
-		UE_LOG(LogTemp, Error, TEXT("CanAddWeaponToWeaponSelected:: BackpackWeapons is null or empty"))
+		UE_LOG(LogTemp, Error, TEXT("CanAddWeaponToWeaponSelected:: BackpackInventory is empty"))
 		
 		HowManyItemsSelected = 0;
 		return false;
 	}
 
-	int32 HowManyItems = 0;
-	for (auto& Weapon : this->BackpackWeapons)
+	HowManyItemsSelected = this->BackpackInventory->GetNumSelected();
+	return HowManyItemsSelected < this->SelectedInventorySpace;
+}
+
+void AGameplayPlayerCharacter::SetBackpackItemSelected(const int32& BackPackItemIndex, const bool& bIsSelected, const int32& WhichSlot)
+{
+	if (!this->BackpackInventory->SetItemSelected(BackPackItemIndex, bIsSelected, WhichSlot))
+	{
+		return;
+	}
+
+	// The menu sees the change right away; the server's answer replicates back over it
+	if (this->Role < ROLE_Authority)
 	{
-		// If an item is selected, 
-		// stores how many IsSelected items are there
-		if (Weapon.bIsSelected)
+		this->ServerSetBackpackItemSelected(BackPackItemIndex, bIsSelected, WhichSlot);
+	}
+
+	// A newly slotted weapon starts loading now rather than when the loadout is spawned
+	if (WhichSlot >= 1 && WhichSlot <= 3 && this->BackpackInventory->GetItem(BackPackItemIndex).WeaponToSpawnAsset.IsPending())
+	{
+		this->PrefetchSlottedWeapons();
+	}
+}
+
+void AGameplayPlayerCharacter::PrefetchSlottedWeapons()
+{
+	UShooterGameInstance* ShooterGameInstance = this->GetShooterGameInstance();
+	if (ShooterGameInstance == nullptr)
+	{
+		return;
+	}
+
+	TArray<FStringAssetReference> WeaponClassPaths;
+	for (int32 Slot = 1; Slot <= 3; ++Slot)
+	{
+		const int32 ItemIndex = this->BackpackInventory->GetItemInSlot(Slot);
+		if (ItemIndex != INDEX_NONE && !this->BackpackInventory->GetItem(ItemIndex).WeaponToSpawnAsset.IsNull())
 		{
-			HowManyItems++;
+			WeaponClassPaths.AddUnique(this->BackpackInventory->GetItem(ItemIndex).WeaponToSpawnAsset.ToStringReference());
 		}
 	}
 
-	HowManyItemsSelected = HowManyItems;
-	return HowManyItemsSelected < this->SelectedInventorySpace;
+	// The new handle replaces the old one, so classes that left the slots may unload
+	if (WeaponClassPaths.Num() == 0)
+	{
+		this->SlottedWeaponsHandle.Reset();
+		return;
+	}
+
+	this->SlottedWeaponsHandle = ShooterGameInstance->GetStreamableManager().RequestAsyncLoad(WeaponClassPaths, FStreamableDelegate(), FStreamableManager::AsyncLoadHighPriority);
 }
 
-void AGameplayPlayerCharacter::SetBackpackItemSelected(const int32& BackPackItemIndex, const bool& bIsSelected, const int32& WhichSlot)
+void AGameplayPlayerCharacter::RequestBackpackIcons()
 {
-	if (this->BackpackWeapons.Num() <= 0)
+	UShooterGameInstance* ShooterGameInstance = this->GetShooterGameInstance();
+	if (ShooterGameInstance == nullptr)
+	{
+		UE_LOG(LogTemp, Error, TEXT("RequestBackpackIcons:: there is no shooter game instance"))
+		return;
+	}
+
+	TArray<FStringAssetReference> IconPaths;
+	const TArray<FWeaponBackpackItem>& Items = this->BackpackInventory->GetItems();
+	this->BackpackItemAtlasCells.SetNum(Items.Num());
+
+	for (int32 Index = 0; Index < Items.Num(); ++Index)
 	{
-		UE_LOG(LogTemp, Error, TEXT("SetBackpackItemSelected:: BackpackWeapons is null or empty"))
+		const FWeaponBackpackItem& Item = Items[Index];
+		this->BackpackItemAtlasCells[Index] = Item.BackpackImageAsset.IsNull() ? INDEX_NONE : IconPaths.AddUnique(Item.BackpackImageAsset.ToStringReference());
+	}
+
+	// The atlas already holds exactly these icons, nothing needs to load
+	if (IconPaths.Num() == 0 || (this->BackpackIconAtlas && IconPaths == this->AtlasIconPaths))
+	{
+		this->OnBackpackIconsLoadedDelegate.Broadcast();
 		return;
 	}
 
-	// Modify struct values inside TArray
-	FWeaponBackpackItem& Weapon = this->BackpackWeapons[BackPackItemIndex];
-	Weapon.bIsSelected = bIsSelected;
-	Weapon.InSlot = WhichSlot;
+	this->AtlasIconPaths = IconPaths;
+	this->BackpackIconsHandle = ShooterGameInstance->GetStreamableManager().RequestAsyncLoad(IconPaths, FStreamableDelegate::CreateUObject(this, &AGameplayPlayerCharacter::OnBackpackIconsLoaded));
+}
+
+void AGameplayPlayerCharacter::ReleaseBackpackIcons()
+{
+	if (this->BackpackIconsHandle.IsValid())
+	{
+		this->BackpackIconsHandle->ReleaseHandle();
+		this->BackpackIconsHandle.Reset();
+	}
+}
+
+UTexture2D* AGameplayPlayerCharacter::GetBackpackIcon(int32 BackpackItemIndex) const
+{
+	if (!this->BackpackInventory->IsValidItem(BackpackItemIndex))
+	{
+		UE_LOG(LogTemp, Error, TEXT("GetBackpackIcon:: BackpackItemIndex is out of range"))
+		return nullptr;
+	}
+
+	return this->BackpackInventory->GetItem(BackpackItemIndex).BackpackImageAsset.Get();
+}
+
+FSlateBrush AGameplayPlayerCharacter::GetBackpackIconBrush(int32 BackpackItemIndex) const
+{
+	if (this->BackpackIconAtlas == nullptr || !this->BackpackItemAtlasCells.IsValidIndex(BackpackItemIndex))
+	{
+		return FSlateBrush();
+	}
+
+	return this->BackpackIconAtlas->MakeIconBrush(this->BackpackItemAtlasCells[BackpackItemIndex]);
+}
+
+void AGameplayPlayerCharacter::OnBackpackIconsLoaded()
+{
+	if (this->BackpackIconAtlas == nullptr)
+	{
+		this->BackpackIconAtlas = NewObject<UBackpackIconAtlas>(this);
+	}
+
+	// Every icon is resident now, so the first draw needs no load of its own
+	this->BackpackIconAtlas->Build(this, this->AtlasIconPaths);
+
+	// The atlas holds its own copy, the separate icons do not need to stay resident
+	this->ReleaseBackpackIcons();
+
+	this->OnBackpackIconsLoadedDelegate.Broadcast();
 }
 
 void AGameplayPlayerCharacter::EquipWeapon_Implementation(ABaseWeapon* Weapon) 
 {
-	if ((this->CurrentWeapon == nullptr || Weapon == nullptr) && (this->CurrentWeapon == Weapon))
+	SCOPE_CYCLE_COUNTER(STAT_ShooterEquipWeapon);
+	INC_DWORD_STAT(STAT_ShooterEquipWeaponCalls);
+
+	if (Weapon == nullptr || Weapon == this->CurrentWeapon)
 	{
-		UE_LOG(LogTemp, Error, TEXT("EquipWeapon:: Weapon is the same as CurrentWeapon"))
+		UE_LOG(LogTemp, Error, TEXT("EquipWeapon:: Weapon is null or the same as CurrentWeapon"))
 		return;
 	}
 
-	// Is this dangerous?
-	this->NewWeaponToEquip = Weapon;
-
-	// Bind the function with FName OnHandleAnimPercent when the timeline advances
-	FOnTimelineFloat HandleAnimPercentProgressFunction;
-	HandleAnimPercentProgressFunction.BindUFunction(this, FName("OnHandleAnimPercent"));
+	// Pressed during a reload or another equip, the equip waits for it to end
+	if (this->HandleWeaponActionInput(EWeaponActionInput::WAI_Equip, Weapon) != EWeaponActionResult::WAR_Execute)
+	{
+		return;
+	}
 
-	// Bind the function with FName OnHandleEquipWeaponFinish when the timeline finishes
-	FOnTimelineEvent HandleAnimPercentEndFunction;
-	HandleAnimPercentEndFunction.BindUFunction(this, FName("OnHandleEquipWeaponFinish"));
-	this->EquipWeaponTimeline.SetTimelineFinishedFunc(HandleAnimPercentEndFunction);
+	// The owning client plays the equip right away and lets the server catch up
+	if (this->Role == ROLE_AutonomousProxy)
+	{
+		this->ServerEquipWeapon(Weapon, this->RecordWeaponAction(EWeaponActionType::WAT_Equip, Weapon));
+	}
 
-	// Bind the function with FName HandleWeaponDownEventFunction when this event occurs
-	FOnTimelineEvent HandleWeaponDownEventFunction;
-	HandleWeaponDownEventFunction.BindUFunction(this, FName("OnHandleWeaponDownEvent"));
-	
-	// Setting up the loop status and the function that is going to fire when the timeline ticks
-	this->EquipWeaponTimeline.AddInterpFloat(this->WeaponReloadUpCurve, HandleAnimPercentProgressFunction);
-	this->EquipWeaponTimeline.AddEvent(0.25f, HandleWeaponDownEventFunction);
-	this->EquipWeaponTimeline.SetLooping(false);
+	// Is this dangerous?
+	this->NewWeaponToEquip = Weapon;
 
-	// Start the timeline ...
-	this->EquipWeaponTimeline.PlayFromStart();
+	// Start the timeline; the weapons are swapped by its event at 0.25 seconds
+	this->PlayWeaponTimeline(EWeaponTimelineType::WTT_Equip, this->WeaponReloadUpCurve, 0.25f);
 }
 
 void AGameplayPlayerCharacter::ReloadWeapon_Implementation()
 {
-	if (this->bIsReloading)
-	{
-		UE_LOG(LogTemp, Error, TEXT("ReloadWeapon:: player is already reloading"))
-		
-		// If we are reloading, we can't fire
-		this->bCanFire = false;
-		// If we have started to change weapon during reloading,
-		// then we stop reloading
-		this->bIsReloading = false;
-		// We are starting changing the weapon but different
-		// than usual
-		this->bIsChangingWeapon = true;
-		
-		// TODO: finish ReloadWeapon when it is already reloading
-		float WeaponPullDownInterp = FMath::FInterpConstantTo(this->WeaponPullDownPercent, 1.0f, FApp::GetDeltaTime(), 5.0f);
-		this->WeaponPullDownPercent = WeaponPullDownInterp;
+	SCOPE_CYCLE_COUNTER(STAT_ShooterReloadWeapon);
+	INC_DWORD_STAT(STAT_ShooterReloadWeaponCalls);
 
+	if (this->CurrentWeapon == nullptr)
+	{
+		UE_LOG(LogTemp, Error, TEXT("ReloadWeapon:: CurrentWeapon is null or empty"))
 		return;
 	}
 
-	// We can't fire while reloading
-	this->bIsReloading = true;
-	this->bCanFire = false;
+	// A full magazine or an empty backpack has nothing to reload
+	bool bHaveAmmo = false;
+	bool bMagIsFull = false;
+	bool bHaveAmmoInBackpack = false;
+	this->CurrentWeapon->HaveAmmoInMag(bHaveAmmo, bMagIsFull);
+	this->CurrentWeapon->HaveAmmoInBackpack(bHaveAmmoInBackpack);
 
-	// Bind the function with FName OnHandleWeaponReloadDown when the timeline advances
-	FOnTimelineFloat WeaponReloadingDownProgressFunction;
-	WeaponReloadingDownProgressFunction.BindUFunction(this, FName("OnHandleWeaponReloadDown"));
+	if (bMagIsFull || !bHaveAmmoInBackpack)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("ReloadWeapon:: Mag is full or backpack is empty; GameplayPlayerCharacter can't reload weapon"))
+		return;
+	}
+
+	// A second reload is ignored; one pressed during an equip waits for it to end
+	const EWeaponActionResult Result = this->HandleWeaponActionInput(EWeaponActionInput::WAI_Reload);
+	if (Result != EWeaponActionResult::WAR_Execute)
+	{
+		if (Result == EWeaponActionResult::WAR_Refuse)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("ReloadWeapon:: player is already reloading or has no weapon"))
+		}
 
-	// Bind the function with FName OnHandleWeaponReloadDownFinish when the timeline finishes
-	FOnTimelineEvent WeaponReloadingDownEndFunction;
-	WeaponReloadingDownEndFunction.BindUFunction(this, FName("OnHandleWeaponReloadDownFinish"));
-	this->WeaponReloadDownTimeline.SetTimelineFinishedFunc(WeaponReloadingDownEndFunction);
+		return;
+	}
 
-	// Setting up the loop status and the function that is going to fire when the timeline ticks
-	this->WeaponReloadDownTimeline.AddInterpFloat(this->WeaponReloadDownCurve, WeaponReloadingDownProgressFunction);
-	this->WeaponReloadDownTimeline.SetLooping(false);
+	// The owning client plays the reload right away and lets the server catch up
+	if (this->Role == ROLE_AutonomousProxy)
+	{
+		this->ServerReloadWeapon(this->RecordWeaponAction(EWeaponActionType::WAT_Reload, this->CurrentWeapon));
+	}
 
 	// Start the timeline ...
-	this->WeaponReloadDownTimeline.PlayFromStart();
+	this->PlayWeaponTimeline(EWeaponTimelineType::WTT_ReloadDown, this->WeaponReloadDownCurve);
 }
 
 void AGameplayPlayerCharacter::FireWeapon_Implementation()
 {
-	if (!this->bCanFire)
+	SCOPE_CYCLE_COUNTER(STAT_ShooterFireWeapon);
+	INC_DWORD_STAT(STAT_ShooterFireWeaponCalls);
+
+	// Pressed during a reload or an equip, the shot waits for it to end
+	const EWeaponActionResult Result = this->HandleWeaponActionInput(EWeaponActionInput::WAI_Fire);
+	if (Result != EWeaponActionResult::WAR_Execute)
 	{
-		UE_LOG(LogTemp, Error, TEXT("FireWeapon:: player can't fire"))
+		if (Result == EWeaponActionResult::WAR_Refuse)
+		{
+			UE_LOG(LogTemp, Error, TEXT("FireWeapon:: player can't fire"))
+		}
+
 		return;
 	}
 
@@ -173,13 +788,19 @@ void AGameplayPlayerCharacter::FireWeapon_Implementation()
 
 	if (bHaveAmmo)
 	{
-		this->CurrentWeapon->Fire();
-
-		// Let's call dispatcher informing all subscribers
-		if (this->OnCharacterFireDelegate.IsBound())
+		// The owning client fires right away and lets the server catch up
+		if (this->Role == ROLE_AutonomousProxy)
 		{
-			this->OnCharacterFireDelegate.Broadcast(this->CurrentWeapon->WeaponType);
+			// Shots between two frames keep their own time; the server gets it on its own clock
+			const float WorldTime = GetWorld()->GetTimeSeconds();
+			const float ShotTime = this->CurrentWeapon->GetNextShotTimestamp() >= 0.0f ? this->CurrentWeapon->GetNextShotTimestamp() : WorldTime;
+			AGameStateBase* GameState = GetWorld()->GetGameState();
+			const float ServerShotTime = GameState ? ShotTime + GameState->GetServerWorldTimeSeconds() - WorldTime : ShotTime;
+
+			this->ServerFireWeapon(this->RecordWeaponAction(EWeaponActionType::WAT_Fire, this->CurrentWeapon), ServerShotTime);
 		}
+
+		this->FireCurrentWeaponShot();
 	}
 	else
 	{
@@ -196,91 +817,249 @@ void AGameplayPlayerCharacter::FireWeapon_Implementation()
 	}
 }
 
+void AGameplayPlayerCharacter::FireCurrentWeaponShot()
+{
+	// The shot is counted and broadcast by HandleWeaponShotEmitted once the weapon really fires it
+	this->CurrentWeapon->Fire();
+}
+
+void AGameplayPlayerCharacter::HandleWeaponShotEmitted(ABaseWeapon* Weapon)
+{
+	// Other clients play this shot's effects when the counter reaches them
+	this->BurstCounter++;
+
+	// Let's call dispatcher informing all subscribers
+	if (this->OnCharacterFireDelegate.IsBound())
+	{
+		this->OnCharacterFireDelegate.Broadcast(Weapon->GetWeaponType());
+	}
+}
+
+void AGameplayPlayerCharacter::StartFireWeapon()
+{
+	// The trigger runs where the player is, every shot it fires is sent on its own
+	if (this->CurrentWeapon == nullptr)
+	{
+		UE_LOG(LogTemp, Error, TEXT("StartFireWeapon:: CurrentWeapon is null or empty"))
+		return;
+	}
+
+	this->CurrentWeapon->StartFiring();
+}
+
+void AGameplayPlayerCharacter::StopFireWeapon()
+{
+	if (this->CurrentWeapon)
+	{
+		this->CurrentWeapon->StopFiring();
+	}
+}
+
+bool AGameplayPlayerCharacter::HandleTriggerShot(float ShotTime)
+{
+	if (this->CurrentWeapon == nullptr)
+	{
+		return false;
+	}
+
+	// A held trigger keeps its latest pull buffered, so it fires on the frame the reload or equip ends
+	if (!this->bCanFire)
+	{
+		this->HandleWeaponActionInput(EWeaponActionInput::WAI_Fire);
+		return false;
+	}
+
+	// An empty magazine makes FireWeapon start a reload instead of firing
+	const bool bHaveAmmo = this->CurrentWeapon->CurrentAmmoInMag > 0;
+
+	this->CurrentWeapon->SetNextShotTimestamp(ShotTime);
+	this->FireWeapon();
+
+	return bHaveAmmo;
+}
+
 void AGameplayPlayerCharacter::SpawnWeaponsAndAssignToSlots()
 {
-	if (this->BackpackWeapons.Num() <= 0)
+	SCOPE_CYCLE_COUNTER(STAT_ShooterSpawnWeapons);
+	INC_DWORD_STAT(STAT_ShooterSpawnWeaponsCalls);
+
+	// Weapons are spawned by the server and replicate to us
+	if (this->Role < ROLE_Authority)
 	{
-		UE_LOG(LogTemp, Error, TEXT("SpawnWeaponsAndAssignToSlots:: BackpackWeapons is null or empty"))
+		this->ServerSpawnWeaponsAndAssignToSlots();
 		return;
 	}
 
-	for (int32 Index = 0; Index != this->BackpackWeapons.Num(); ++Index)
+	if (this->BackpackInventory->GetNumItems() <= 0)
 	{
-		FWeaponBackpackItem WeaponBackpackItem = this->BackpackWeapons[Index];
-		
-		// Setup spawn parameter and transform rules
-		FTransform NewWeaponTransform = this->GetTransform();
-		FActorSpawnParameters SpawnParameters;
-		SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
-		FAttachmentTransformRules AttachmentRules(EAttachmentRule::SnapToTarget, false);
+		UE_LOG(LogTemp, Error, TEXT("SpawnWeaponsAndAssignToSlots:: BackpackInventory is empty"))
+		return;
+	}
 
-		ABaseWeapon* SpawnedWeapon = nullptr;
+	// Give the previous loadout back before taking the new one
+	this->ReleaseSlotWeapons();
 
-		switch (WeaponBackpackItem.InSlot)
+	// Ask the slots for their items instead of walking the whole backpack
+	for (int32 Slot = 1; Slot <= 3; ++Slot)
+	{
+		const int32 Index = this->BackpackInventory->GetItemInSlot(Slot);
+		if (Index == INDEX_NONE)
 		{
-			case 1:
+			continue;
+		}
 
-				SpawnedWeapon = GetWorld()->SpawnActor<ABaseWeapon>(WeaponBackpackItem.WeaponToSpawn.Get(), NewWeaponTransform, SpawnParameters);
-				SpawnedWeapon->IndexInBackpack = Index;
+		const FWeaponBackpackItem& WeaponBackpackItem = this->BackpackInventory->GetItem(Index);
 
-				this->WeaponSlot1 = SpawnedWeapon;
-				this->WeaponSlot1->AttachToComponent(this->FPPMesh, FAttachmentTransformRules(EAttachmentRule::SnapToTarget, false), this->WeaponSlot1->AttachSocketNameFPP);
-				// this->AttachToComponent(this->FPPMesh, AttachmentRules, this->WeaponSlot1->AttachSocketNameFPP);
-				break;
+		UClass* WeaponClass = WeaponBackpackItem.WeaponToSpawnAsset.Get();
+		if (WeaponClass == nullptr && !WeaponBackpackItem.WeaponToSpawnAsset.IsNull())
+		{
+			UE_LOG(LogTemp, Warning, TEXT("SpawnWeaponsAndAssignToSlots:: %s was not prefetched, loading it now"), *WeaponBackpackItem.WeaponToSpawnAsset.ToString())
+			WeaponClass = Cast<UClass>(WeaponBackpackItem.WeaponToSpawnAsset.ToStringReference().TryLoad());
+		}
 
-			case 2:
+		ABaseWeapon* SlotWeapon = this->CheckOutWeapon(WeaponClass);
+		if (SlotWeapon == nullptr)
+		{
+			continue;
+		}
+
+		SlotWeapon->IndexInBackpack = Index;
 
-				SpawnedWeapon = GetWorld()->SpawnActor<ABaseWeapon>(WeaponBackpackItem.WeaponToSpawn.Get(), NewWeaponTransform, SpawnParameters);
-				SpawnedWeapon->IndexInBackpack = Index;
+		switch (WeaponBackpackItem.InSlot)
+		{
+			case 1:
+				this->WeaponSlot1 = SlotWeapon;
+				break;
 
-				this->WeaponSlot2 = SpawnedWeapon;
-				this->WeaponSlot2->AttachToComponent(this->FPPMesh, FAttachmentTransformRules(EAttachmentRule::SnapToTarget, false), this->WeaponSlot2->AttachSocketNameFPP);
-				// this->AttachToComponent(this->FPPMesh, AttachmentRules, this->WeaponSlot2->AttachSocketNameFPP);
+			case 2:
+				this->WeaponSlot2 = SlotWeapon;
 				break;
 
 			case 3:
+				this->WeaponSlot3 = SlotWeapon;
+				break;
+		}
+	}
+}
 
-				SpawnedWeapon = GetWorld()->SpawnActor<ABaseWeapon>(WeaponBackpackItem.WeaponToSpawn.Get(), NewWeaponTransform, SpawnParameters);
-				SpawnedWeapon->IndexInBackpack = Index;
+void AGameplayPlayerCharacter::ReleaseSlotWeapons()
+{
+	UWeaponPool* WeaponPool = UWeaponPool::Get(GetWorld());
 
-				this->WeaponSlot3 = SpawnedWeapon;
-				this->WeaponSlot3->AttachToComponent(this->FPPMesh, FAttachmentTransformRules(EAttachmentRule::SnapToTarget, false), this->WeaponSlot3->AttachSocketNameFPP);
-				// this->AttachToComponent(this->FPPMesh, AttachmentRules, this->WeaponSlot3->AttachSocketNameFPP);
-				break;
+	ABaseWeapon** Slots[] = { &this->WeaponSlot1, &this->WeaponSlot2, &this->WeaponSlot3 };
+	for (ABaseWeapon** Slot : Slots)
+	{
+		if (*Slot == nullptr)
+		{
+			continue;
 		}
+
+		if (WeaponPool)
+		{
+			WeaponPool->CheckIn(*Slot);
+		}
+		else
+		{
+			(*Slot)->Destroy();
+		}
+
+		*Slot = nullptr;
+	}
+
+	this->CurrentWeapon = nullptr;
+	this->NewWeaponToEquip = nullptr;
+
+	// Whatever was going on or waiting is over; the server answers what it will now never finish
+	this->WeaponActionStateMachine.ClearBuffer();
+	this->HandleWeaponActionInput(EWeaponActionInput::WAI_Disarmed);
+
+	if (this->PendingServerReload != INDEX_NONE)
+	{
+		this->AcknowledgeWeaponAction((uint16)this->PendingServerReload);
+		this->PendingServerReload = INDEX_NONE;
+	}
+
+	if (this->PendingServerEquip != INDEX_NONE)
+	{
+		this->AcknowledgeWeaponAction((uint16)this->PendingServerEquip);
+		this->PendingServerEquip = INDEX_NONE;
+	}
+
+	if (this->PendingServerFire != INDEX_NONE)
+	{
+		this->AcknowledgeWeaponAction((uint16)this->PendingServerFire);
+		this->PendingServerFire = INDEX_NONE;
 	}
 }
 
-void AGameplayPlayerCharacter::ShowCurrentWeapon(const ABaseWeapon* WeaponToShow)
+ABaseWeapon* AGameplayPlayerCharacter::CheckOutWeapon(TSubclassOf<ABaseWeapon> WeaponClass)
 {
-	// Hide all weapons to be sure that nothing is visible
-	if (this->WeaponSlot1)
-		this->WeaponSlot1->SetActorHiddenInGame(true);
+	UWeaponPool* WeaponPool = UWeaponPool::Get(GetWorld());
+	if (WeaponPool)
+	{
+		return WeaponPool->CheckOut(WeaponClass, this, this->FPPMesh);
+	}
 
-	if (this->WeaponSlot2)
-		this->WeaponSlot2->SetActorHiddenInGame(true);
-	
-	if (this->WeaponSlot3)
-		this->WeaponSlot3->SetActorHiddenInGame(true);
+	// Without a pool we fall back to a plain spawn
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	// Weapons aim from their owner's eyes and never hit their owner
+	SpawnParameters.Owner = this;
+	SpawnParameters.Instigator = this;
 
-	// Do not hide weapon to show
-	if (WeaponToShow == this->WeaponSlot1)
+	ABaseWeapon* SpawnedWeapon = GetWorld()->SpawnActor<ABaseWeapon>(WeaponClass.Get(), this->GetTransform(), SpawnParameters);
+	if (SpawnedWeapon)
 	{
-		this->WeaponSlot1->SetActorHiddenInGame(false);
+		this->AttachWeaponToFPPMesh(SpawnedWeapon);
 	}
-	else if (WeaponToShow == this->WeaponSlot2)
+
+	return SpawnedWeapon;
+}
+
+void AGameplayPlayerCharacter::AttachWeaponToFPPMesh(ABaseWeapon* Weapon)
+{
+	const FName SocketName = Weapon->GetAttachSocketNameFPP();
+	USceneComponent* WeaponRoot = Weapon->GetRootComponent();
+	if (WeaponRoot->GetAttachParent() == this->FPPMesh && WeaponRoot->GetAttachSocketName() == SocketName)
 	{
-		this->WeaponSlot2->SetActorHiddenInGame(false);
+		return;
 	}
-	else if (WeaponToShow == this->WeaponSlot3)
+
+	Weapon->AttachToComponent(this->FPPMesh, FAttachmentTransformRules(EAttachmentRule::SnapToTarget, false), SocketName);
+}
+
+void AGameplayPlayerCharacter::ShowCurrentWeapon(const ABaseWeapon* WeaponToShow)
+{
+	ABaseWeapon* Slots[] = { this->WeaponSlot1, this->WeaponSlot2, this->WeaponSlot3 };
+
+	// Holster all weapons to be sure that nothing is visible; only the shown one stays awake for replication
+	ABaseWeapon* SlotToShow = nullptr;
+	for (ABaseWeapon* SlotWeapon : Slots)
 	{
-		this->WeaponSlot3->SetActorHiddenInGame(false);
+		if (SlotWeapon == nullptr)
+		{
+			continue;
+		}
+
+		if (SlotWeapon == WeaponToShow)
+		{
+			SlotToShow = SlotWeapon;
+		}
+		else
+		{
+			SlotWeapon->SetHolstered(true);
+		}
 	}
-	else
+
+	if (SlotToShow == nullptr)
 	{
 		UE_LOG(LogTemp, Error, TEXT("ShowWeapon:: WeaponToShow is not WeaponSlot1 || WeaponSlot2 || WeaponSlot3"))
 		return;
 	}
+
+	// Snapping to the socket updates the transform right away, so the weapon is in place this frame
+	SlotToShow->SetHolstered(false);
+	this->AttachWeaponToFPPMesh(SlotToShow);
 }
 
 void AGameplayPlayerCharacter::OnHandleAnimPercent(float Value)
@@ -296,13 +1075,24 @@ void AGameplayPlayerCharacter::OnHandleWeaponDownEvent()
 		return;
 	}
 
-	this->SetCurrentWeapon(this->NewWeaponToEquip);
-	this->ShowCurrentWeapon(this->NewWeaponToEquip);
+	// Swapped; a weapon left here would look like an equip still playing
+	ABaseWeapon* EquippedWeapon = this->NewWeaponToEquip;
+	this->NewWeaponToEquip = nullptr;
+
+	this->SetCurrentWeapon(EquippedWeapon);
+	this->ShowCurrentWeapon(EquippedWeapon);
+
+	if (this->PendingServerEquip != INDEX_NONE)
+	{
+		this->AcknowledgeWeaponAction((uint16)this->PendingServerEquip);
+		this->PendingServerEquip = INDEX_NONE;
+	}
 }
 
 void AGameplayPlayerCharacter::OnHandleEquipWeaponFinish()
 {
-	this->bIsChangingWeapon = false;
+	this->HandleWeaponActionInput(EWeaponActionInput::WAI_EquipFinished);
+	this->FlushBufferedWeaponInputs();
 }
 
 void AGameplayPlayerCharacter::OnHandleWeaponPullDownPercent(float Value)
@@ -313,7 +1103,8 @@ void AGameplayPlayerCharacter::OnHandleWeaponPullDownPercent(float Value)
 void AGameplayPlayerCharacter::OnFinishedHandleWeaponPullDownPercent()
 {
 	// Player is not changing weapon anymore
-	this->bIsChangingWeapon = false;
+	this->HandleWeaponActionInput(EWeaponActionInput::WAI_EquipFinished);
+	this->FlushBufferedWeaponInputs();
 }
 
 void AGameplayPlayerCharacter::OnHandleWeaponReloadDown(float Value)
@@ -336,7 +1127,7 @@ void AGameplayPlayerCharacter::OnHandleWeaponReloadDownFinish()
 	}
 
 	FTimerHandle ReloadTimerHandle;
-	GetWorld()->GetTimerManager().SetTimer(ReloadTimerHandle, this, &AGameplayPlayerCharacter::OnHandleReloadTime, this->CurrentWeapon->ReloadTime, false);
+	GetWorld()->GetTimerManager().SetTimer(ReloadTimerHandle, this, &AGameplayPlayerCharacter::OnHandleReloadTime, this->CurrentWeapon->GetReloadTime(), false);
 }
 
 void AGameplayPlayerCharacter::OnHandleReloadTime()
@@ -347,21 +1138,8 @@ void AGameplayPlayerCharacter::OnHandleReloadTime()
 		return;
 	}
 
-	// Bind the function with FName OnHandleWeaponReloadUp when the timeline advances
-	FOnTimelineFloat WeaponReloadingUpProgressFunction;
-	WeaponReloadingUpProgressFunction.BindUFunction(this, FName("OnHandleWeaponReloadUp"));
-
-	// Bind the function with FName OnHandleWeaponReloadUpFinish when the timeline finishes
-	FOnTimelineEvent WeaponReloadingUpEndFunction;
-	WeaponReloadingUpEndFunction.BindUFunction(this, FName("OnHandleWeaponReloadUpFinish"));
-	this->WeaponReloadUpTimeline.SetTimelineFinishedFunc(WeaponReloadingUpEndFunction);
-
-	// Setting up the loop status and the function that is going to fire when the timeline ticks
-	this->WeaponReloadUpTimeline.AddInterpFloat(this->WeaponReloadUpCurve, WeaponReloadingUpProgressFunction);
-	this->WeaponReloadUpTimeline.SetLooping(false);
-
 	// Start the timeline ...
-	this->WeaponReloadUpTimeline.PlayFromStart();
+	this->PlayWeaponTimeline(EWeaponTimelineType::WTT_ReloadUp, this->WeaponReloadUpCurve);
 }
 
 void AGameplayPlayerCharacter::OnHandleWeaponReloadUp(float Value)
@@ -385,33 +1163,171 @@ void AGameplayPlayerCharacter::OnHandleWeaponReloadUpFinish()
 
 	// Weapon is up, so we can add ammo now
 	this->CurrentWeapon->Reload();
-	this->bIsReloading = false;
-	this->bCanFire = true;
+
+	if (this->PendingServerReload != INDEX_NONE)
+	{
+		this->AcknowledgeWeaponAction((uint16)this->PendingServerReload);
+		this->PendingServerReload = INDEX_NONE;
+	}
+
+	// The predicted refill now counts when replaying over the server's ammo
+	for (int32 ActionIndex = this->PendingWeaponActions.Num() - 1; ActionIndex >= 0; --ActionIndex)
+	{
+		FPredictedWeaponAction& Action = this->PendingWeaponActions[ActionIndex];
+		if (Action.Type == EWeaponActionType::WAT_Reload)
+		{
+			Action.bApplied = true;
+			break;
+		}
+	}
+
+	// Only now, with the magazine refilled, may the inputs pressed during the reload run
+	this->HandleWeaponActionInput(EWeaponActionInput::WAI_ReloadFinished);
+	this->FlushBufferedWeaponInputs();
+}
+
+EWeaponActionState AGameplayPlayerCharacter::GetWeaponActionState() const
+{
+	return this->WeaponActionStateMachine.GetState();
 }
 
-void AGameplayPlayerCharacter::Tick(float DeltaTime)
+EWeaponActionResult AGameplayPlayerCharacter::HandleWeaponActionInput(EWeaponActionInput Input, ABaseWeapon* Weapon)
 {
-	Super::Tick(DeltaTime);
+	const float Time = GetWorld() ? GetWorld()->GetTimeSeconds() : 0.0f;
+	const EWeaponActionResult Result = this->WeaponActionStateMachine.HandleInput(Input, Time, Weapon);
 
-	// Fires up equip weapon timeline
-	if (this->EquipWeaponTimeline.IsPlaying())
+	if (Result == EWeaponActionResult::WAR_Execute)
 	{
-		this->EquipWeaponTimeline.TickTimeline(DeltaTime);
+		this->MirrorWeaponActionState();
 	}
 
-	// Fires up reload weapon down timeline
-	if (this->WeaponReloadDownTimeline.IsPlaying())
+	return Result;
+}
+
+void AGameplayPlayerCharacter::MirrorWeaponActionState()
+{
+	const EWeaponActionState State = this->WeaponActionStateMachine.GetState();
+
+	this->bCanFire = FWeaponActionStateMachine::GetTransition(State, EWeaponActionInput::WAI_Fire).Result == EWeaponActionResult::WAR_Execute;
+	this->bIsReloading = State == EWeaponActionState::WAS_Reloading;
+	this->bIsChangingWeapon = State == EWeaponActionState::WAS_Equipping;
+}
+
+void AGameplayPlayerCharacter::FlushBufferedWeaponInputs()
+{
+	// The server replays what its client already did, however late it gets there
+	const float BufferTime = IsLocallyControlled() ? this->WeaponInputBufferTime : MAX_FLT;
+
+	// Stops once the state refuses or buffers the rest, e.g. when a buffered reload or equip starts
+	EWeaponActionInput Input;
+	ABaseWeapon* Weapon = nullptr;
+	while (this->WeaponActionStateMachine.PopReadyInput(GetWorld()->GetTimeSeconds(), BufferTime, Input, Weapon))
 	{
-		this->WeaponReloadDownTimeline.TickTimeline(DeltaTime);
+		switch (Input)
+		{
+			case EWeaponActionInput::WAI_Fire:
+				// A shot the client sent fires at the time it carried, anything else is a local press
+				if (this->PendingServerFire != INDEX_NONE)
+				{
+					this->ExecutePendingServerFire();
+				}
+				else
+				{
+					this->FireWeapon();
+				}
+				break;
+
+			case EWeaponActionInput::WAI_Reload:
+				this->ReloadWeapon();
+				break;
+
+			case EWeaponActionInput::WAI_Equip:
+				if (Weapon)
+				{
+					this->EquipWeapon(Weapon);
+				}
+				break;
+
+			default:
+				break;
+		}
 	}
+}
+
+void AGameplayPlayerCharacter::HandleWeaponTimelineUpdate(EWeaponTimelineType Type, float Value)
+{
+	SCOPE_CYCLE_COUNTER(STAT_ShooterTimelineHandlers);
+	INC_DWORD_STAT(STAT_ShooterTimelineHandlerCalls);
+
+	switch (Type)
+	{
+		case EWeaponTimelineType::WTT_Equip:
+			this->OnHandleAnimPercent(Value);
+			break;
+
+		case EWeaponTimelineType::WTT_ReloadDown:
+			this->OnHandleWeaponReloadDown(Value);
+			break;
+
+		case EWeaponTimelineType::WTT_ReloadUp:
+			this->OnHandleWeaponReloadUp(Value);
+			break;
+	}
+}
+
+void AGameplayPlayerCharacter::HandleWeaponTimelineEvent(EWeaponTimelineType Type)
+{
+	SCOPE_CYCLE_COUNTER(STAT_ShooterTimelineHandlers);
+	INC_DWORD_STAT(STAT_ShooterTimelineHandlerCalls);
+
+	// Only the equip timeline has an event: the moment the old weapon is down
+	if (Type == EWeaponTimelineType::WTT_Equip)
+	{
+		this->OnHandleWeaponDownEvent();
+	}
+}
 
-	// Fires up reload weapon up timeline
-	if (this->WeaponReloadUpTimeline.IsPlaying())
+void AGameplayPlayerCharacter::HandleWeaponTimelineFinished(EWeaponTimelineType Type)
+{
+	SCOPE_CYCLE_COUNTER(STAT_ShooterTimelineHandlers);
+	INC_DWORD_STAT(STAT_ShooterTimelineHandlerCalls);
+
+	switch (Type)
 	{
-		this->WeaponReloadUpTimeline.TickTimeline(DeltaTime);
+		case EWeaponTimelineType::WTT_Equip:
+			this->OnHandleEquipWeaponFinish();
+			break;
+
+		case EWeaponTimelineType::WTT_ReloadDown:
+			this->OnHandleWeaponReloadDownFinish();
+			break;
+
+		case EWeaponTimelineType::WTT_ReloadUp:
+			this->OnHandleWeaponReloadUpFinish();
+			break;
 	}
 }
 
+void AGameplayPlayerCharacter::PlayWeaponTimeline(EWeaponTimelineType Type, UCurveFloat* Curve, float EventTime)
+{
+	UWeaponTimelineScheduler* Scheduler = UWeaponTimelineScheduler::Get(GetWorld());
+	if (Scheduler)
+	{
+		Scheduler->Play(this, Type, Curve, EventTime);
+		return;
+	}
+
+	UE_LOG(LogTemp, Warning, TEXT("PlayWeaponTimeline:: there is no weapon timeline scheduler in this world, skipping the animation"))
+
+	// Without a scheduler the timeline jumps straight to its end
+	if (EventTime >= 0.0f)
+	{
+		this->HandleWeaponTimelineEvent(Type);
+	}
+
+	this->HandleWeaponTimelineFinished(Type);
+}
+
 void AGameplayPlayerCharacter::SetupPlayerInputComponent(UInputComponent* PlayerInputComponent)
 {
 	Super::SetupPlayerInputComponent(PlayerInputComponent);
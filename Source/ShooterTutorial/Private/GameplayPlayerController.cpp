@@ -1,6 +1,12 @@
 // Fill out your copyright notice in the Description page of Project Settings.
 
 #include "GameplayPlayerController.h"
+#include "GameplayMenuInterface.h"
+#include "DebugTelemetry.h"
+#include "ShooterTutorial.h"
+
+DECLARE_CYCLE_STAT(TEXT("Controller Input"), STAT_ShooterControllerInput, STATGROUP_ShooterTutorial);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Controller Input Events"), STAT_ShooterControllerInputEvents, STATGROUP_ShooterTutorial);
 
 AGameplayPlayerController::AGameplayPlayerController() {}
 
@@ -22,6 +28,12 @@ void AGameplayPlayerController::BeginPlay()
 	GyroSensitivityMin = 20.0f;
 	GyroSensitivityMax = 60.0f;
 	GyroSensitivityCurrent = 40.0f;
+
+	// Menus are built ahead of time, one per frame, instead of on key press
+	if (IsLocalPlayerController())
+	{
+		GetWorldTimerManager().SetTimerForNextTick(this, &AGameplayPlayerController::PrecreateNextMenu);
+	}
 }
 
 void AGameplayPlayerController::SetupInputComponent()
@@ -41,16 +53,35 @@ void AGameplayPlayerController::SetupInputComponent()
 	InputComponent->BindKey(EKeys::NumPadThree, IE_Pressed, this, &AGameplayPlayerController::OnPressedThreeButton);
 	InputComponent->BindKey(EKeys::R, IE_Pressed, this, &AGameplayPlayerController::OnPressedRButton);
 	InputComponent->BindKey(EKeys::LeftMouseButton, IE_Pressed, this, &AGameplayPlayerController::OnPressedLeftMouseButton);
+	InputComponent->BindKey(EKeys::LeftMouseButton, IE_Released, this, &AGameplayPlayerController::OnReleasedLeftMouseButton);
 }
 
 bool AGameplayPlayerController::InputMotion(const FVector & Tilt, const FVector & RotationRate, const FVector & Gravity, const FVector & Acceleration)
 {
+	SCOPE_CYCLE_COUNTER(STAT_ShooterControllerInput);
+	INC_DWORD_STAT(STAT_ShooterControllerInputEvents);
+
 	if (this->CurrentControllingDevice != EControllingDeviceEnum::CDE_Gyro)
 	{
 		UE_LOG(LogTemp, Warning, TEXT("InputMotion:: this->CurrentControllingDevice is not of type CDE_GYRO"))
 		return false;
 	}
 
+	if (this->bUseGyroRotationRate)
+	{
+		// Integrate at the rate samples arrive; the camera picks the sum up at the start of the next frame
+		const double Now = FPlatformTime::Seconds();
+		const float SampleDeltaTime = this->LastMotionTime > 0.0 ? FMath::Min((float)(Now - this->LastMotionTime), 0.1f) : 0.0f;
+		this->LastMotionTime = Now;
+
+		this->GyroRateFilter.MinCutoff = this->GyroFilterMinCutoff;
+		this->GyroRateFilter.Beta = this->GyroFilterBeta;
+
+		const FVector FilteredRate = this->GyroRateFilter.Filter(RotationRate, SampleDeltaTime);
+		this->PendingGyroRotation += FilteredRate * SampleDeltaTime;
+		return true;
+	}
+
 	FVector SensitiveTilt = GyroSensitivityCurrent * Tilt;
 	FVector Result = LastTilt - SensitiveTilt;
 	AddPitchInput(Result.Z);
@@ -61,65 +92,218 @@ bool AGameplayPlayerController::InputMotion(const FVector & Tilt, const FVector
 
 bool AGameplayPlayerController::InputTouch(uint32 Handle, ETouchType::Type Type, const FVector2D & TouchLocation, FDateTime DeviceTimestamp, uint32 TouchpadIndex)
 {
+	SCOPE_CYCLE_COUNTER(STAT_ShooterControllerInput);
+	INC_DWORD_STAT(STAT_ShooterControllerInputEvents);
+
+	if (TouchpadIndex != 0 || Handle >= EKeys::NUM_TOUCH_KEYS)
+	{
+		return false;
+	}
+
+	// Events only record state here; look movement is applied once per frame in ProcessTouchFrame
+	FTouchFingerState& Finger = this->TouchFingers[Handle];
 	bool bResult = false;
 
 	switch (Type)
 	{
 		case ETouchType::Began:
 		{
-			if (TouchpadIndex == 0)
+			Finger.Role = this->IsInTouchFireZone(TouchLocation) ? ETouchFingerRole::TFR_Fire : ETouchFingerRole::TFR_Look;
+			Finger.StartLocation = TouchLocation;
+			Finger.LastLocation = TouchLocation;
+			Finger.StartTime = GetWorld()->GetRealTimeSeconds();
+
+			if (Finger.Role == ETouchFingerRole::TFR_Fire)
+			{
+				AGameplayPlayerCharacter* GameplayPlayerCharacter = this->GetGameplayPlayerCharacter();
+				if (GameplayPlayerCharacter)
+				{
+					GameplayPlayerCharacter->StartFireWeapon();
+				}
+			}
+			else
 			{
 				LastTouch = TouchLocation;
-				bResult = true;
 			}
 
+			bResult = true;
 			break;
 		}
 		case ETouchType::Moved:
 		{
-			if (TouchpadIndex == 0)
+			if (Finger.Role == ETouchFingerRole::TFR_Look)
 			{
-				float TouchXLocation = TouchLocation.X;
-				float TouchYLocation = TouchLocation.Y;
+				Finger.PendingDelta += TouchLocation - Finger.LastLocation;
+				Finger.LastLocation = TouchLocation;
+				LastTouch = TouchLocation;
+				bResult = true;
+			}
 
-				float DiffLastTouchX = TouchXLocation - LastTouch.X;
-				float DiffLastTouchY = TouchYLocation - LastTouch.Y;
+			break;
+		}
+		case ETouchType::Ended:
+		{
+			if (Finger.Role == ETouchFingerRole::TFR_Fire)
+			{
+				AGameplayPlayerCharacter* GameplayPlayerCharacter = this->GetGameplayPlayerCharacter();
+				if (GameplayPlayerCharacter)
+				{
+					GameplayPlayerCharacter->StopFireWeapon();
+				}
 
-				AddYawInput(DiffLastTouchX / TouchSensitivityCurrent);
-				AddPitchInput(DiffLastTouchY / TouchSensitivityCurrent);
+				bResult = true;
+			}
+			else if (Finger.Role == ETouchFingerRole::TFR_Look)
+			{
+				// The last stretch of movement is still applied on the next frame
+				Finger.PendingDelta += TouchLocation - Finger.LastLocation;
+				Finger.LastLocation = TouchLocation;
 
-				LastTouch = TouchLocation;
+				this->RecognizeTouchGesture(Finger, TouchLocation);
 				bResult = true;
 			}
-			
+
+			Finger.Role = ETouchFingerRole::TFR_None;
 			break;
 		}
-
 	}
 
 	return bResult;
 }
 
+void AGameplayPlayerController::PlayerTick(float DeltaTime)
+{
+	// Before Super so the look movement is part of this frame's rotation
+	this->ProcessTouchFrame();
+	this->ProcessGyroFrame();
+
+	Super::PlayerTick(DeltaTime);
+}
+
+void AGameplayPlayerController::ProcessGyroFrame()
+{
+	if (this->PendingGyroRotation.IsZero())
+	{
+		return;
+	}
+
+	// Same axes and signs as the tilt path, so existing sensitivities keep their feel
+	const FVector SensitiveRotation = this->GyroSensitivityCurrent * this->PendingGyroRotation;
+	AddPitchInput(-SensitiveRotation.Z);
+	AddYawInput(SensitiveRotation.X);
+
+	this->PendingGyroRotation = FVector::ZeroVector;
+}
+
+void AGameplayPlayerController::ProcessTouchFrame()
+{
+	FVector2D LookDelta(ForceInitToZero);
+	for (FTouchFingerState& Finger : this->TouchFingers)
+	{
+		LookDelta += Finger.PendingDelta;
+		Finger.PendingDelta = FVector2D::ZeroVector;
+	}
+
+	if (!LookDelta.IsZero())
+	{
+		const float InverseSensitivity = 1.0f / this->TouchSensitivityCurrent;
+		AddYawInput(LookDelta.X * InverseSensitivity);
+		AddPitchInput(LookDelta.Y * InverseSensitivity);
+	}
+
+	for (int32 Index = 0; Index < this->NumPendingTouchGestures; ++Index)
+	{
+		const FTouchGesture& Gesture = this->PendingTouchGestures[Index];
+		if (Gesture.bIsSwipe)
+		{
+			this->OnTouchSwipeDelegate.Broadcast(Gesture.Location, Gesture.Direction);
+		}
+		else
+		{
+			this->OnTouchTapDelegate.Broadcast(Gesture.Location);
+		}
+	}
+
+	this->NumPendingTouchGestures = 0;
+}
+
+bool AGameplayPlayerController::IsInTouchFireZone(const FVector2D& TouchLocation) const
+{
+	int32 ViewportSizeX = 0;
+	int32 ViewportSizeY = 0;
+	GetViewportSize(ViewportSizeX, ViewportSizeY);
+
+	if (ViewportSizeX <= 0 || ViewportSizeY <= 0)
+	{
+		return false;
+	}
+
+	const FVector2D Normalized(TouchLocation.X / ViewportSizeX, TouchLocation.Y / ViewportSizeY);
+	return Normalized.X >= this->TouchFireZoneMin.X && Normalized.X <= this->TouchFireZoneMax.X
+		&& Normalized.Y >= this->TouchFireZoneMin.Y && Normalized.Y <= this->TouchFireZoneMax.Y;
+}
+
+void AGameplayPlayerController::RecognizeTouchGesture(const FTouchFingerState& Finger, const FVector2D& EndLocation)
+{
+	if (this->NumPendingTouchGestures >= EKeys::NUM_TOUCH_KEYS)
+	{
+		return;
+	}
+
+	const FVector2D Travel = EndLocation - Finger.StartLocation;
+	const float Distance = Travel.Size();
+	const float Duration = GetWorld()->GetRealTimeSeconds() - Finger.StartTime;
+
+	FTouchGesture Gesture;
+	Gesture.Location = Finger.StartLocation;
+	Gesture.Direction = FVector2D::ZeroVector;
+
+	if (Duration <= this->TapMaxDuration && Distance <= this->TapMaxDistance)
+	{
+		Gesture.bIsSwipe = false;
+	}
+	else if (Duration <= this->SwipeMaxDuration && Distance >= this->SwipeMinDistance)
+	{
+		Gesture.bIsSwipe = true;
+		Gesture.Direction = Travel / Distance;
+	}
+	else
+	{
+		return;
+	}
+
+	this->PendingTouchGestures[this->NumPendingTouchGestures++] = Gesture;
+}
+
 void AGameplayPlayerController::MouseX(float Value)
 {
-	if (this->CurrentControllingDevice == EControllingDeviceEnum::CDE_Mouse && GEngine)
+	SCOPE_CYCLE_COUNTER(STAT_ShooterControllerInput);
+	INC_DWORD_STAT(STAT_ShooterControllerInputEvents);
+
+	if (this->CurrentControllingDevice == EControllingDeviceEnum::CDE_Mouse)
 	{
-		GEngine->AddOnScreenDebugMessage(AlwaysAddKey, 5.f, FColor::Yellow, FString("MouseX: ") + FString::SanitizeFloat(Value));
+		SHOOTER_RECORD_TELEMETRY(MouseX, Value);
 		AddYawInput(Value * MouseSensitivityCurrent);
 	}
 }
 
 void AGameplayPlayerController::MouseY(float Value)
 {
-	if (this->CurrentControllingDevice == EControllingDeviceEnum::CDE_Mouse && GEngine)
+	SCOPE_CYCLE_COUNTER(STAT_ShooterControllerInput);
+	INC_DWORD_STAT(STAT_ShooterControllerInputEvents);
+
+	if (this->CurrentControllingDevice == EControllingDeviceEnum::CDE_Mouse)
 	{
-		GEngine->AddOnScreenDebugMessage(AlwaysAddKey, 5.f, FColor::Blue, FString("MouseY: ") + FString::SanitizeFloat(Value));
+		SHOOTER_RECORD_TELEMETRY(MouseY, Value);
 		AddPitchInput(Value * MouseSensitivityCurrent);
 	}
 }
 
 void AGameplayPlayerController::OnPressedOneButton()
 {
+	SCOPE_CYCLE_COUNTER(STAT_ShooterControllerInput);
+	INC_DWORD_STAT(STAT_ShooterControllerInputEvents);
+
 	AGameplayPlayerCharacter* GameplayPlayerCharacter = this->GetGameplayPlayerCharacter();
 	check(GameplayPlayerCharacter);
 
@@ -128,6 +312,9 @@ void AGameplayPlayerController::OnPressedOneButton()
 
 void AGameplayPlayerController::OnPressedTwoButton()
 {
+	SCOPE_CYCLE_COUNTER(STAT_ShooterControllerInput);
+	INC_DWORD_STAT(STAT_ShooterControllerInputEvents);
+
 	AGameplayPlayerCharacter* GameplayPlayerCharacter = this->GetGameplayPlayerCharacter();
 	check(GameplayPlayerCharacter);
 
@@ -136,6 +323,9 @@ void AGameplayPlayerController::OnPressedTwoButton()
 
 void AGameplayPlayerController::OnPressedThreeButton()
 {
+	SCOPE_CYCLE_COUNTER(STAT_ShooterControllerInput);
+	INC_DWORD_STAT(STAT_ShooterControllerInputEvents);
+
 	AGameplayPlayerCharacter* GameplayPlayerCharacter = this->GetGameplayPlayerCharacter();
 	check(GameplayPlayerCharacter);
 
@@ -144,73 +334,172 @@ void AGameplayPlayerController::OnPressedThreeButton()
 
 void AGameplayPlayerController::OnClickedOButton()
 {
+	SCOPE_CYCLE_COUNTER(STAT_ShooterControllerInput);
+	INC_DWORD_STAT(STAT_ShooterControllerInputEvents);
+
 	if (!this->WChangeSensitivityMenu)
 	{
 		UE_LOG(LogTemp, Warning, TEXT("OnClickedOButton:: ChangeSensitivityMenu was not set"))
 		return;
 	}
 
-	// Get BP Widget object and add it to the viewport
-	this->ChangeSensitivityMenu = CreateWidget<UUserWidget>(this, this->WChangeSensitivityMenu);
-	if (this->ChangeSensitivityMenu)
-	{
-		FInputModeUIOnly InputMode;
-		InputMode.SetLockMouseToViewportBehavior(EMouseLockMode::LockOnCapture);
-		SetInputMode(InputMode);
-
-		bShowMouseCursor = true;
-		this->ChangeSensitivityMenu->AddToViewport();
-	}
+	this->ToggleCachedMenu(this->ChangeSensitivityMenu, this->WChangeSensitivityMenu);
 }
 
 void AGameplayPlayerController::OnPressedRButton()
 {
+	SCOPE_CYCLE_COUNTER(STAT_ShooterControllerInput);
+	INC_DWORD_STAT(STAT_ShooterControllerInputEvents);
+
 	AGameplayPlayerCharacter* GameplayPlayerCharacter = this->GetGameplayPlayerCharacter();
 	check(GameplayPlayerCharacter);
 
-	if (!(GameplayPlayerCharacter->bIsReloading || !GameplayPlayerCharacter->bIsChangingWeapon))
-	{
-		bool bHaveAmmo = false;
-		bool bMagIsFull = false;
-		GameplayPlayerCharacter->CurrentWeapon->HaveAmmoInMag(bHaveAmmo, bMagIsFull);
+	// The character's weapon action state decides whether the reload runs now, after an equip or not at all
+	GameplayPlayerCharacter->ReloadWeapon();
+}
 
-		if (bMagIsFull)
-		{
-			UE_LOG(LogTemp, Warning, TEXT("OnPressedLeftMouseButton:: Mag is full; GameplayPlayerCharacter can't reload weapon"))
-				return;
-		}
+void AGameplayPlayerController::OnPressedLeftMouseButton()
+{
+	SCOPE_CYCLE_COUNTER(STAT_ShooterControllerInput);
+	INC_DWORD_STAT(STAT_ShooterControllerInputEvents);
 
-		GameplayPlayerCharacter->ReloadWeapon();
-	}
+	AGameplayPlayerCharacter* GameplayPlayerCharacter = this->GetGameplayPlayerCharacter();
+	check(GameplayPlayerCharacter);
+
+	GameplayPlayerCharacter->StartFireWeapon();
 }
 
-void AGameplayPlayerController::OnPressedLeftMouseButton()
+void AGameplayPlayerController::OnReleasedLeftMouseButton()
 {
+	SCOPE_CYCLE_COUNTER(STAT_ShooterControllerInput);
+	INC_DWORD_STAT(STAT_ShooterControllerInputEvents);
+
 	AGameplayPlayerCharacter* GameplayPlayerCharacter = this->GetGameplayPlayerCharacter();
 	check(GameplayPlayerCharacter);
 
-	GameplayPlayerCharacter->FireWeapon();
+	GameplayPlayerCharacter->StopFireWeapon();
 }
 
 void AGameplayPlayerController::OnShownWeaponSelectionMenu()
 {
+	SCOPE_CYCLE_COUNTER(STAT_ShooterControllerInput);
+	INC_DWORD_STAT(STAT_ShooterControllerInputEvents);
+
 	if (!this->WWeaponSelection)
 	{
 		UE_LOG(LogTemp, Warning, TEXT("OnShownWeaponSelectionMenu:: WeaponSelection was not set"))
 		return;
 	}
 
-	// Get BP Widget object and add it to the viewport
-	this->WeaponSelectionMenu = CreateWidget<UUserWidget>(this, this->WWeaponSelection);
-	if (this->WeaponSelectionMenu)
+	this->ToggleCachedMenu(this->WeaponSelectionMenu, this->WWeaponSelection);
+
+	// Icons are only resident while the selection menu is open
+	AGameplayPlayerCharacter* GameplayPlayerCharacter = this->GetGameplayPlayerCharacter();
+	if (GameplayPlayerCharacter && this->WeaponSelectionMenu && this->ShownMenu == this->WeaponSelectionMenu)
+	{
+		GameplayPlayerCharacter->RequestBackpackIcons();
+	}
+}
+
+void AGameplayPlayerController::PrecreateNextMenu()
+{
+	if (this->WChangeSensitivityMenu && this->ChangeSensitivityMenu == nullptr)
+	{
+		this->ChangeSensitivityMenu = this->CreateCachedMenu(this->WChangeSensitivityMenu);
+	}
+	else if (this->WWeaponSelection && this->WeaponSelectionMenu == nullptr)
+	{
+		this->WeaponSelectionMenu = this->CreateCachedMenu(this->WWeaponSelection);
+	}
+	else
+	{
+		return;
+	}
+
+	GetWorldTimerManager().SetTimerForNextTick(this, &AGameplayPlayerController::PrecreateNextMenu);
+}
+
+UUserWidget* AGameplayPlayerController::CreateCachedMenu(TSubclassOf<UUserWidget> WidgetClass)
+{
+	UUserWidget* Menu = CreateWidget<UUserWidget>(this, WidgetClass);
+	if (Menu)
+	{
+		// Kept in the viewport but collapsed, so showing it is only a visibility change; OnMenuShown refreshes its data
+		Menu->SetVisibility(ESlateVisibility::Collapsed);
+		Menu->AddToViewport();
+	}
+
+	return Menu;
+}
+
+void AGameplayPlayerController::ToggleCachedMenu(UUserWidget*& Menu, TSubclassOf<UUserWidget> WidgetClass)
+{
+	// Pressed before precreation got to it
+	if (Menu == nullptr)
+	{
+		Menu = this->CreateCachedMenu(WidgetClass);
+		if (Menu == nullptr)
+		{
+			return;
+		}
+	}
+
+	if (Menu == this->ShownMenu && Menu->IsInViewport() && Menu->GetVisibility() != ESlateVisibility::Collapsed)
+	{
+		this->HideMenus();
+		return;
+	}
+
+	// One menu at a time; the other one gives back what it keeps resident first
+	if (this->ShownMenu)
+	{
+		this->HideMenus();
+	}
+
+	// A menu blueprint that closed itself with RemoveFromParent goes back in, the only case that rebuilds it
+	if (!Menu->IsInViewport())
 	{
-		FInputModeUIOnly InputMode;
-		InputMode.SetLockMouseToViewportBehavior(EMouseLockMode::LockOnCapture);
-		SetInputMode(InputMode);
+		Menu->AddToViewport();
+	}
+
+	this->ShownMenu = Menu;
 
-		bShowMouseCursor = true;
-		this->WeaponSelectionMenu->AddToViewport();
+	if (Menu->GetClass()->ImplementsInterface(UGameplayMenuInterface::StaticClass()))
+	{
+		IGameplayMenuInterface::Execute_OnMenuShown(Menu);
 	}
+
+	Menu->SetVisibility(ESlateVisibility::Visible);
+
+	FInputModeUIOnly InputMode;
+	InputMode.SetLockMouseToViewportBehavior(EMouseLockMode::LockOnCapture);
+	SetInputMode(InputMode);
+
+	bShowMouseCursor = true;
+}
+
+void AGameplayPlayerController::HideMenus()
+{
+	if (this->ShownMenu)
+	{
+		this->ShownMenu->SetVisibility(ESlateVisibility::Collapsed);
+
+		if (this->ShownMenu->GetClass()->ImplementsInterface(UGameplayMenuInterface::StaticClass()))
+		{
+			IGameplayMenuInterface::Execute_OnMenuHidden(this->ShownMenu);
+		}
+
+		this->ShownMenu = nullptr;
+	}
+
+	AGameplayPlayerCharacter* GameplayPlayerCharacter = this->GetGameplayPlayerCharacter();
+	if (GameplayPlayerCharacter)
+	{
+		GameplayPlayerCharacter->ReleaseBackpackIcons();
+	}
+
+	SetInputMode(FInputModeGameOnly());
+	bShowMouseCursor = false;
 }
 
 void AGameplayPlayerController::SetCurrentControllingDevice(const EControllingDeviceEnum NewCurrent)
@@ -222,6 +511,11 @@ void AGameplayPlayerController::SetCurrentControllingDevice(const EControllingDe
 	}
 
 	this->CurrentControllingDevice = NewCurrent;
+
+	// Gyro history from before the switch would show up as a jump
+	this->GyroRateFilter.Reset();
+	this->PendingGyroRotation = FVector::ZeroVector;
+	this->LastMotionTime = 0.0;
 }
 
 float AGameplayPlayerController::GetSensitivity(const EControllingDeviceEnum WhichDevice, const bool bCurrentDevice)
@@ -0,0 +1,29 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "GameplayWorldManager.h"
+#include "Engine/World.h"
+#include "ShooterTutorial.h"
+
+UWorld* UGameplayWorldManager::GetWorld() const
+{
+	return GetOuter() ? GetOuter()->GetWorld() : nullptr;
+}
+
+void UGameplayWorldManager::Tick(float DeltaTime)
+{
+}
+
+bool UGameplayWorldManager::IsTickable() const
+{
+	return !HasAnyFlags(RF_ClassDefaultObject) && GetWorld() != nullptr;
+}
+
+TStatId UGameplayWorldManager::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UGameplayWorldManager, STATGROUP_ShooterTutorial);
+}
+
+UWorld* UGameplayWorldManager::GetTickableGameObjectWorld() const
+{
+	return GetWorld();
+}
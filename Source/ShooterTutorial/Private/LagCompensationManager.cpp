@@ -0,0 +1,352 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "LagCompensationManager.h"
+#include "Engine/World.h"
+#include "GameFramework/Character.h"
+#include "Components/CapsuleComponent.h"
+#include "GameplayGameState.h"
+#include "ShooterTutorial.h"
+
+DECLARE_CYCLE_STAT(TEXT("Lag Compensation Record"), STAT_ShooterLagCompensationRecord, STATGROUP_ShooterTutorial);
+DECLARE_CYCLE_STAT(TEXT("Lag Compensation Rewind"), STAT_ShooterLagCompensationRewind, STATGROUP_ShooterTutorial);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Lag Compensated Rays"), STAT_ShooterLagCompensatedRays, STATGROUP_ShooterTutorial);
+DECLARE_MEMORY_STAT(TEXT("Lag Compensation History"), STAT_ShooterLagCompensationMemory, STATGROUP_ShooterTutorial);
+
+/* Frames kept per target; a power of two so the ring index is a mask */
+static const uint32 LagCompensationHistorySize = 64;
+
+/* Distance along a normalized ray to a capsule whose core runs from A to B, or a negative value if it is missed */
+static float IntersectRayCapsule(const FVector& RayOrigin, const FVector& RayDirection, const FVector& A, const FVector& B, float Radius)
+{
+	const FVector Axis = B - A;
+	const FVector OriginToA = RayOrigin - A;
+
+	const float AxisDotAxis = FVector::DotProduct(Axis, Axis);
+	const float AxisDotDirection = FVector::DotProduct(Axis, RayDirection);
+	const float AxisDotOrigin = FVector::DotProduct(Axis, OriginToA);
+	const float DirectionDotOrigin = FVector::DotProduct(RayDirection, OriginToA);
+	const float OriginDotOrigin = FVector::DotProduct(OriginToA, OriginToA);
+
+	// The cylinder part, unless the ray runs along the axis and can only enter through a cap
+	const float QuadA = AxisDotAxis - AxisDotDirection * AxisDotDirection;
+	if (QuadA > KINDA_SMALL_NUMBER)
+	{
+		const float QuadB = AxisDotAxis * DirectionDotOrigin - AxisDotOrigin * AxisDotDirection;
+		const float QuadC = AxisDotAxis * OriginDotOrigin - AxisDotOrigin * AxisDotOrigin - Radius * Radius * AxisDotAxis;
+		const float Discriminant = QuadB * QuadB - QuadA * QuadC;
+		if (Discriminant < 0.0f)
+		{
+			return -1.0f;
+		}
+
+		const float Distance = (-QuadB - FMath::Sqrt(Discriminant)) / QuadA;
+		const float AlongAxis = AxisDotOrigin + Distance * AxisDotDirection;
+		if (AlongAxis > 0.0f && AlongAxis < AxisDotAxis)
+		{
+			return Distance;
+		}
+	}
+
+	// Through one of the two hemispheres; the nearer entry wins
+	float Distance = -1.0f;
+	const FVector CapCenters[] = { A, B };
+	for (const FVector& CapCenter : CapCenters)
+	{
+		const FVector OriginToCap = RayOrigin - CapCenter;
+		const float CapB = FVector::DotProduct(RayDirection, OriginToCap);
+		const float CapC = FVector::DotProduct(OriginToCap, OriginToCap) - Radius * Radius;
+		const float CapDiscriminant = CapB * CapB - CapC;
+		if (CapDiscriminant > 0.0f)
+		{
+			const float CapDistance = -CapB - FMath::Sqrt(CapDiscriminant);
+			if (CapDistance >= 0.0f && (Distance < 0.0f || CapDistance < Distance))
+			{
+				Distance = CapDistance;
+			}
+		}
+	}
+
+	return Distance;
+}
+
+ULagCompensationManager* ULagCompensationManager::Get(const UWorld* World)
+{
+	if (World == nullptr)
+	{
+		return nullptr;
+	}
+
+	AGameplayGameState* GameState = World->GetGameState<AGameplayGameState>();
+	return GameState ? GameState->GetLagCompensationManager() : nullptr;
+}
+
+int32 ULagCompensationManager::AddTarget(ACharacter* Character)
+{
+	if (Character == nullptr)
+	{
+		UE_LOG(LogTemp, Error, TEXT("AddTarget:: Character is null or empty"))
+		return INDEX_NONE;
+	}
+
+	if (this->FrameTimes.Num() == 0)
+	{
+		this->FrameTimes.SetNumZeroed(LagCompensationHistorySize);
+	}
+
+	int32 Handle = INDEX_NONE;
+	if (this->FreeHandles.Num() > 0)
+	{
+		Handle = this->FreeHandles.Pop(false);
+	}
+	else
+	{
+		Handle = this->Targets.Num();
+
+		this->Targets.AddDefaulted();
+		this->FirstFrames.AddUninitialized();
+		this->Locations.AddUninitialized(LagCompensationHistorySize);
+		this->Rotations.AddUninitialized(LagCompensationHistorySize);
+		this->CapsuleSizes.AddUninitialized(LagCompensationHistorySize);
+	}
+
+	// Frames before the next recorded one hold someone else's history, or nothing
+	this->Targets[Handle] = Character;
+	this->FirstFrames[Handle] = this->NumFrames;
+
+	return Handle;
+}
+
+void ULagCompensationManager::RemoveTarget(int32 Handle)
+{
+	if (!this->Targets.IsValidIndex(Handle))
+	{
+		UE_LOG(LogTemp, Error, TEXT("RemoveTarget:: Handle %d is out of range"), Handle)
+		return;
+	}
+
+	this->Targets[Handle] = nullptr;
+	this->FreeHandles.Add(Handle);
+}
+
+void ULagCompensationManager::GetTargetActors(TArray<AActor*>& OutActors) const
+{
+	OutActors.Reset(this->GetNumTargets());
+	for (const TWeakObjectPtr<ACharacter>& Target : this->Targets)
+	{
+		if (Target.IsValid())
+		{
+			OutActors.Add(Target.Get());
+		}
+	}
+}
+
+float ULagCompensationManager::ClampRewindTime(float Timestamp) const
+{
+	const float Now = GetWorld() ? GetWorld()->GetTimeSeconds() : Timestamp;
+	const float RewindTime = FMath::Min(this->MaxRewindTime, this->GetHistoryDuration());
+	return FMath::Clamp(Timestamp, Now - RewindTime, Now);
+}
+
+float ULagCompensationManager::GetHistoryDuration() const
+{
+	return (LagCompensationHistorySize - 1) * FMath::Max(this->RecordInterval, KINDA_SMALL_NUMBER);
+}
+
+int32 ULagCompensationManager::GetSampleIndex(int32 Handle, uint32 Frame) const
+{
+	return Handle * LagCompensationHistorySize + (Frame & (LagCompensationHistorySize - 1));
+}
+
+bool ULagCompensationManager::FindFrames(float Timestamp, uint32& OutOlderFrame, uint32& OutNewerFrame, float& OutAlpha) const
+{
+	if (this->NumFrames == 0)
+	{
+		return false;
+	}
+
+	const uint32 NewestFrame = this->NumFrames - 1;
+	const uint32 OldestFrame = this->NumFrames > LagCompensationHistorySize ? this->NumFrames - LagCompensationHistorySize : 0;
+
+	// Outside the history the closest frame is used as is
+	if (Timestamp >= this->FrameTimes[NewestFrame & (LagCompensationHistorySize - 1)])
+	{
+		OutOlderFrame = OutNewerFrame = NewestFrame;
+		OutAlpha = 0.0f;
+		return true;
+	}
+
+	if (Timestamp <= this->FrameTimes[OldestFrame & (LagCompensationHistorySize - 1)])
+	{
+		OutOlderFrame = OutNewerFrame = OldestFrame;
+		OutAlpha = 0.0f;
+		return true;
+	}
+
+	// Frame times only grow, so the ring is searched in halves
+	uint32 Low = OldestFrame;
+	uint32 High = NewestFrame;
+	while (High - Low > 1)
+	{
+		const uint32 Middle = Low + (High - Low) / 2;
+		if (this->FrameTimes[Middle & (LagCompensationHistorySize - 1)] <= Timestamp)
+		{
+			Low = Middle;
+		}
+		else
+		{
+			High = Middle;
+		}
+	}
+
+	const float LowTime = this->FrameTimes[Low & (LagCompensationHistorySize - 1)];
+	const float HighTime = this->FrameTimes[High & (LagCompensationHistorySize - 1)];
+
+	OutOlderFrame = Low;
+	OutNewerFrame = High;
+	OutAlpha = HighTime > LowTime ? (Timestamp - LowTime) / (HighTime - LowTime) : 0.0f;
+	return true;
+}
+
+bool ULagCompensationManager::RewindLineTrace(float Timestamp, const FVector& Start, const FVector& End, const AActor* IgnoredActor, FHitResult& OutHit) const
+{
+	SCOPE_CYCLE_COUNTER(STAT_ShooterLagCompensationRewind);
+	INC_DWORD_STAT(STAT_ShooterLagCompensatedRays);
+
+	uint32 OlderFrame = 0;
+	uint32 NewerFrame = 0;
+	float Alpha = 0.0f;
+	if (!this->FindFrames(Timestamp, OlderFrame, NewerFrame, Alpha))
+	{
+		return false;
+	}
+
+	const FVector Ray = End - Start;
+	const float RayLength = Ray.Size();
+	if (RayLength <= KINDA_SMALL_NUMBER)
+	{
+		return false;
+	}
+
+	const FVector RayDirection = Ray / RayLength;
+
+	int32 HitHandle = INDEX_NONE;
+	float HitDistance = RayLength;
+	FVector HitCapsuleCenter = FVector::ZeroVector;
+
+	for (int32 Handle = 0; Handle < this->Targets.Num(); ++Handle)
+	{
+		const ACharacter* Target = this->Targets[Handle].Get();
+		if (Target == nullptr || Target == IgnoredActor)
+		{
+			continue;
+		}
+
+		// A target added after the older frame has no pose there; use its first one
+		const uint32 FirstFrame = this->FirstFrames[Handle];
+		if (NewerFrame < FirstFrame)
+		{
+			continue;
+		}
+
+		const int32 OlderIndex = this->GetSampleIndex(Handle, FMath::Max(OlderFrame, FirstFrame));
+		const int32 NewerIndex = this->GetSampleIndex(Handle, NewerFrame);
+
+		const FVector Location = FMath::Lerp(this->Locations[OlderIndex], this->Locations[NewerIndex], Alpha);
+		const FQuat Rotation = FQuat::FastLerp(this->Rotations[OlderIndex], this->Rotations[NewerIndex], Alpha).GetNormalized();
+		const FVector2D CapsuleSize = FMath::Lerp(this->CapsuleSizes[OlderIndex], this->CapsuleSizes[NewerIndex], Alpha);
+
+		// Capsule size is radius and half height, the half height includes the hemisphere
+		const float Radius = CapsuleSize.X;
+		const FVector CoreHalfExtent = Rotation.GetAxisZ() * FMath::Max(CapsuleSize.Y - Radius, 0.0f);
+
+		const float Distance = IntersectRayCapsule(Start, RayDirection, Location - CoreHalfExtent, Location + CoreHalfExtent, Radius);
+		if (Distance >= 0.0f && Distance < HitDistance)
+		{
+			HitHandle = Handle;
+			HitDistance = Distance;
+			HitCapsuleCenter = Location;
+		}
+	}
+
+	if (HitHandle == INDEX_NONE)
+	{
+		return false;
+	}
+
+	ACharacter* HitCharacter = this->Targets[HitHandle].Get();
+	const FVector HitLocation = Start + RayDirection * HitDistance;
+
+	OutHit = FHitResult(HitDistance / RayLength);
+	OutHit.bBlockingHit = true;
+	OutHit.Distance = HitDistance;
+	OutHit.TraceStart = Start;
+	OutHit.TraceEnd = End;
+	OutHit.Location = HitLocation;
+	OutHit.ImpactPoint = HitLocation;
+	OutHit.Normal = (HitLocation - HitCapsuleCenter).GetSafeNormal();
+	OutHit.ImpactNormal = OutHit.Normal;
+	OutHit.Actor = HitCharacter;
+	OutHit.Component = HitCharacter->GetCapsuleComponent();
+
+	return true;
+}
+
+void ULagCompensationManager::RecordFrame()
+{
+	SCOPE_CYCLE_COUNTER(STAT_ShooterLagCompensationRecord);
+
+	const uint32 Frame = this->NumFrames;
+	this->FrameTimes[Frame & (LagCompensationHistorySize - 1)] = GetWorld()->GetTimeSeconds();
+
+	for (int32 Handle = 0; Handle < this->Targets.Num(); ++Handle)
+	{
+		const ACharacter* Target = this->Targets[Handle].Get();
+		if (Target == nullptr)
+		{
+			continue;
+		}
+
+		const UCapsuleComponent* Capsule = Target->GetCapsuleComponent();
+		const int32 SampleIndex = this->GetSampleIndex(Handle, Frame);
+
+		this->Locations[SampleIndex] = Target->GetActorLocation();
+		this->Rotations[SampleIndex] = Target->GetActorQuat();
+		this->CapsuleSizes[SampleIndex] = Capsule ? FVector2D(Capsule->GetScaledCapsuleRadius(), Capsule->GetScaledCapsuleHalfHeight()) : FVector2D::ZeroVector;
+	}
+
+	this->NumFrames++;
+}
+
+void ULagCompensationManager::Tick(float DeltaTime)
+{
+	// A frame per interval rather than per tick, so a fast server does not shorten the history
+	this->TimeSinceRecord += DeltaTime;
+	if (this->NumFrames == 0 || this->TimeSinceRecord >= this->RecordInterval)
+	{
+		this->TimeSinceRecord = this->NumFrames == 0 ? 0.0f : FMath::Fmod(this->TimeSinceRecord, FMath::Max(this->RecordInterval, KINDA_SMALL_NUMBER));
+		this->RecordFrame();
+	}
+
+	SET_MEMORY_STAT(STAT_ShooterLagCompensationMemory, this->GetAllocatedSize());
+}
+
+bool ULagCompensationManager::IsTickable() const
+{
+	return this->GetNumTargets() > 0 && Super::IsTickable();
+}
+
+SIZE_T ULagCompensationManager::GetAllocatedSize() const
+{
+	return this->Targets.GetAllocatedSize()
+		+ this->FirstFrames.GetAllocatedSize()
+		+ this->FreeHandles.GetAllocatedSize()
+		+ this->FrameTimes.GetAllocatedSize()
+		+ this->Locations.GetAllocatedSize()
+		+ this->Rotations.GetAllocatedSize()
+		+ this->CapsuleSizes.GetAllocatedSize();
+}
+
+TStatId ULagCompensationManager::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(ULagCompensationManager, STATGROUP_ShooterTutorial);
+}
@@ -0,0 +1,173 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "ProjectilePool.h"
+#include "Engine/World.h"
+#include "GameplayGameState.h"
+#include "ShooterTutorial.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Projectiles Acquired"), STAT_ShooterProjectilesAcquired, STATGROUP_ShooterTutorial);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Projectile Pool Misses"), STAT_ShooterProjectilePoolMisses, STATGROUP_ShooterTutorial);
+
+namespace
+{
+	void DumpProjectilePools(UWorld* World)
+	{
+		UProjectilePool* ProjectilePool = UProjectilePool::Get(World);
+		if (ProjectilePool == nullptr)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("DumpProjectilePools:: there is no projectile pool in this world"))
+			return;
+		}
+
+		ProjectilePool->DumpPoolStats();
+	}
+
+	FAutoConsoleCommandWithWorld DumpProjectilePoolsCommand(
+		TEXT("Shooter.DumpProjectilePools"),
+		TEXT("Logs occupancy and allocation miss counters of every projectile pool"),
+		FConsoleCommandWithWorldDelegate::CreateStatic(&DumpProjectilePools));
+}
+
+UProjectilePool* UProjectilePool::Get(const UWorld* World)
+{
+	if (World == nullptr)
+	{
+		return nullptr;
+	}
+
+	AGameplayGameState* GameState = World->GetGameState<AGameplayGameState>();
+	return GameState ? GameState->GetProjectilePool() : nullptr;
+}
+
+void UProjectilePool::Prewarm(TSubclassOf<ABaseProjectile> ProjectileClass, int32 Count)
+{
+	if (!ProjectileClass)
+	{
+		UE_LOG(LogTemp, Error, TEXT("Prewarm:: ProjectileClass is null or empty"))
+		return;
+	}
+
+	FProjectilePoolBucket& Bucket = this->Buckets.FindOrAdd(ProjectileClass.Get());
+	Bucket.FreeProjectiles.Reserve(Count);
+
+	while (Bucket.Stats.NumActive + Bucket.FreeProjectiles.Num() < Count)
+	{
+		ABaseProjectile* Projectile = this->SpawnPooledProjectile(ProjectileClass.Get());
+		if (Projectile == nullptr)
+		{
+			break;
+		}
+
+		Bucket.FreeProjectiles.Add(Projectile);
+	}
+
+	Bucket.Stats.NumFree = Bucket.FreeProjectiles.Num();
+}
+
+ABaseProjectile* UProjectilePool::Acquire(TSubclassOf<ABaseProjectile> ProjectileClass, const FTransform& LaunchTransform, AActor* NewOwner, APawn* NewInstigator, float CatchUpTime)
+{
+	if (!ProjectileClass)
+	{
+		UE_LOG(LogTemp, Error, TEXT("Acquire:: ProjectileClass is null or empty"))
+		return nullptr;
+	}
+
+	FProjectilePoolBucket& Bucket = this->Buckets.FindOrAdd(ProjectileClass.Get());
+
+	ABaseProjectile* Projectile = nullptr;
+	while (Projectile == nullptr && Bucket.FreeProjectiles.Num() > 0)
+	{
+		// Something outside the pool may have destroyed a pooled projectile
+		Projectile = Bucket.FreeProjectiles.Pop(false);
+		if (Projectile && Projectile->IsPendingKill())
+		{
+			Projectile = nullptr;
+		}
+	}
+
+	if (Projectile == nullptr)
+	{
+		// The pool was too small; grow it and remember it so the map can be resized
+		Bucket.Stats.NumMisses++;
+		INC_DWORD_STAT(STAT_ShooterProjectilePoolMisses);
+
+		Projectile = this->SpawnPooledProjectile(ProjectileClass.Get());
+		if (Projectile == nullptr)
+		{
+			return nullptr;
+		}
+	}
+
+	INC_DWORD_STAT(STAT_ShooterProjectilesAcquired);
+
+	Bucket.Stats.NumActive++;
+	Bucket.Stats.NumFree = Bucket.FreeProjectiles.Num();
+	Bucket.Stats.PeakActive = FMath::Max(Bucket.Stats.PeakActive, Bucket.Stats.NumActive);
+
+	Projectile->ActivateFromPool(LaunchTransform, NewOwner, NewInstigator, CatchUpTime);
+	return Projectile;
+}
+
+void UProjectilePool::Release(ABaseProjectile* Projectile)
+{
+	if (Projectile == nullptr)
+	{
+		UE_LOG(LogTemp, Error, TEXT("Release:: Projectile is null or empty"))
+		return;
+	}
+
+	if (!Projectile->IsActiveInWorld())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Release:: Projectile was already given back to the pool"))
+		return;
+	}
+
+	Projectile->DeactivateToPool();
+
+	FProjectilePoolBucket& Bucket = this->Buckets.FindOrAdd(Projectile->GetClass());
+	Bucket.FreeProjectiles.Add(Projectile);
+	Bucket.Stats.NumActive = FMath::Max(Bucket.Stats.NumActive - 1, 0);
+	Bucket.Stats.NumFree = Bucket.FreeProjectiles.Num();
+}
+
+FProjectilePoolStats UProjectilePool::GetPoolStats(TSubclassOf<ABaseProjectile> ProjectileClass) const
+{
+	const FProjectilePoolBucket* Bucket = this->Buckets.Find(ProjectileClass.Get());
+	return Bucket ? Bucket->Stats : FProjectilePoolStats();
+}
+
+void UProjectilePool::DumpPoolStats() const
+{
+	for (const auto& Pair : this->Buckets)
+	{
+		const FProjectilePoolStats& Stats = Pair.Value.Stats;
+		UE_LOG(LogTemp, Log, TEXT("ProjectilePool:: %s Active=%d Free=%d Peak=%d Misses=%d"), *GetNameSafe(Pair.Key), Stats.NumActive, Stats.NumFree, Stats.PeakActive, Stats.NumMisses);
+	}
+}
+
+bool UProjectilePool::IsTickable() const
+{
+	// The pool only reacts to Acquire and Release calls
+	return false;
+}
+
+ABaseProjectile* UProjectilePool::SpawnPooledProjectile(UClass* ProjectileClass)
+{
+	UWorld* World = GetWorld();
+	if (World == nullptr)
+	{
+		UE_LOG(LogTemp, Error, TEXT("SpawnPooledProjectile:: pool has no world"))
+		return nullptr;
+	}
+
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	ABaseProjectile* Projectile = World->SpawnActor<ABaseProjectile>(ProjectileClass, FTransform::Identity, SpawnParameters);
+	if (Projectile)
+	{
+		Projectile->DeactivateToPool();
+	}
+
+	return Projectile;
+}
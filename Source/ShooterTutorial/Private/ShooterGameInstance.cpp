@@ -2,6 +2,20 @@
 
 #include "ShooterGameInstance.h"
 
+void UShooterGameInstance::Init()
+{
+	Super::Init();
 
+	if (this->WeaponCatalogAsset.IsNull())
+	{
+		UE_LOG(LogTemp, Log, TEXT("Init:: WeaponCatalogAsset was not set, weapons use their own stats"))
+		return;
+	}
 
-
+	// The catalog is tiny and needed by the first weapon spawned, so load it right away
+	this->WeaponCatalog = Cast<UWeaponCatalog>(this->WeaponCatalogAsset.ToStringReference().TryLoad());
+	if (this->WeaponCatalog == nullptr)
+	{
+		UE_LOG(LogTemp, Error, TEXT("Init:: could not load the weapon catalog %s"), *this->WeaponCatalogAsset.ToString())
+	}
+}
@@ -0,0 +1,251 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "ShooterSoakDriver.h"
+#include "Engine/World.h"
+#include "Misc/CommandLine.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "HAL/PlatformMemory.h"
+#include "GameplayPlayerCharacter.h"
+
+AShooterSoakDriver::AShooterSoakDriver()
+{
+	PrimaryActorTick.bCanEverTick = true;
+}
+
+bool AShooterSoakDriver::IsRequestedOnCommandLine()
+{
+	return FParse::Param(FCommandLine::Get(), TEXT("ShooterSoak"));
+}
+
+void AShooterSoakDriver::BeginPlay()
+{
+	Super::BeginPlay();
+
+	// The command line wins over config, so CI can sweep the crowd size
+	const TCHAR* CommandLine = FCommandLine::Get();
+	FParse::Value(CommandLine, TEXT("ShooterSoakCharacters="), this->NumCharacters);
+	FParse::Value(CommandLine, TEXT("ShooterSoakSeconds="), this->MeasureSeconds);
+
+	FString CharacterClassPath;
+	if (FParse::Value(CommandLine, TEXT("ShooterSoakCharacterClass="), CharacterClassPath))
+	{
+		this->CharacterClass = FStringClassReference(CharacterClassPath);
+	}
+
+	this->NumCharacters = FMath::Max(this->NumCharacters, 1);
+
+	// Sized for 240 fps so measuring never grows the array
+	this->FrameTimesMs.Reserve(FMath::CeilToInt(this->MeasureSeconds * 240.0f));
+
+	this->SpawnCharacters();
+
+	UE_LOG(LogTemp, Log, TEXT("ShooterSoakDriver:: soaking %d characters for %.1f seconds"), this->Characters.Num(), this->MeasureSeconds)
+}
+
+void AShooterSoakDriver::SpawnCharacters()
+{
+	UClass* SpawnClass = this->CharacterClass.TryLoadClass<AGameplayPlayerCharacter>();
+	if (SpawnClass == nullptr)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("SpawnCharacters:: CharacterClass '%s' could not be loaded, using AGameplayPlayerCharacter"), *this->CharacterClass.ToString())
+		SpawnClass = AGameplayPlayerCharacter::StaticClass();
+	}
+
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	const int32 GridSize = FMath::CeilToInt(FMath::Sqrt((float)this->NumCharacters));
+	this->Characters.Reserve(this->NumCharacters);
+
+	for (int32 Index = 0; Index < this->NumCharacters; ++Index)
+	{
+		const FVector Offset((Index % GridSize) * this->SpawnSpacing, (Index / GridSize) * this->SpawnSpacing, 0.0f);
+		const FTransform SpawnTransform(GetActorRotation(), GetActorLocation() + Offset);
+
+		AGameplayPlayerCharacter* Character = GetWorld()->SpawnActor<AGameplayPlayerCharacter>(SpawnClass, SpawnTransform, SpawnParameters);
+		if (Character == nullptr)
+		{
+			continue;
+		}
+
+		// Characters without a chosen loadout take the first three backpack weapons
+		UBackpackInventoryComponent* Backpack = Character->BackpackInventory;
+		const bool bHasSlottedWeapon = Backpack->GetItemInSlot(1) != INDEX_NONE || Backpack->GetItemInSlot(2) != INDEX_NONE || Backpack->GetItemInSlot(3) != INDEX_NONE;
+
+		if (!bHasSlottedWeapon)
+		{
+			for (int32 ItemIndex = 0; ItemIndex < FMath::Min(Backpack->GetNumItems(), 3); ++ItemIndex)
+			{
+				Character->SetBackpackItemSelected(ItemIndex, true, ItemIndex + 1);
+			}
+		}
+
+		Character->SpawnWeaponsAndAssignToSlots();
+
+		if (Character->WeaponSlot1)
+		{
+			Character->SetCurrentWeapon(Character->WeaponSlot1);
+			Character->ShowCurrentWeapon(Character->WeaponSlot1);
+		}
+
+		this->Characters.Add(Character);
+	}
+}
+
+void AShooterSoakDriver::RunScriptedAction(AGameplayPlayerCharacter* Character, int32 CharacterIndex)
+{
+	if (Character->CurrentWeapon == nullptr || Character->bIsReloading || Character->bIsChangingWeapon)
+	{
+		return;
+	}
+
+	// Characters are out of phase with each other so every path runs every step
+	switch ((this->ActionStep + CharacterIndex) % 4)
+	{
+		case 0:
+			Character->StartFireWeapon();
+			break;
+
+		case 1:
+			Character->StopFireWeapon();
+			break;
+
+		case 2:
+		{
+			bool bHaveAmmo = false;
+			bool bMagIsFull = false;
+			Character->CurrentWeapon->HaveAmmoInMag(bHaveAmmo, bMagIsFull);
+
+			if (!bMagIsFull)
+			{
+				Character->ReloadWeapon();
+			}
+			break;
+		}
+
+		case 3:
+		{
+			ABaseWeapon* Slots[] = { Character->WeaponSlot1, Character->WeaponSlot2, Character->WeaponSlot3 };
+			ABaseWeapon* NextWeapon = Slots[(this->ActionStep / 4 + CharacterIndex) % 3];
+
+			if (NextWeapon && NextWeapon != Character->CurrentWeapon)
+			{
+				Character->EquipWeapon(NextWeapon);
+			}
+			break;
+		}
+	}
+}
+
+void AShooterSoakDriver::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	if (this->bFinished)
+	{
+		return;
+	}
+
+	this->ElapsedSeconds += DeltaTime;
+
+	this->ActionCountdown -= DeltaTime;
+	if (this->ActionCountdown <= 0.0f)
+	{
+		this->ActionCountdown += this->ActionInterval;
+
+		for (int32 Index = 0; Index < this->Characters.Num(); ++Index)
+		{
+			if (this->Characters[Index])
+			{
+				this->RunScriptedAction(this->Characters[Index], Index);
+			}
+		}
+
+		++this->ActionStep;
+	}
+
+	if (this->ElapsedSeconds < this->WarmupSeconds)
+	{
+		return;
+	}
+
+	// GGameThreadTime holds the game thread time of the previous frame
+	this->FrameTimesMs.Add(FPlatformTime::ToMilliseconds(GGameThreadTime));
+
+	const FPlatformMemoryStats MemoryStats = FPlatformMemory::GetStats();
+	this->PeakUsedPhysical = FMath::Max<uint64>(this->PeakUsedPhysical, MemoryStats.UsedPhysical);
+	this->PeakUsedVirtual = FMath::Max<uint64>(this->PeakUsedVirtual, MemoryStats.UsedVirtual);
+
+	if (this->ElapsedSeconds >= this->WarmupSeconds + this->MeasureSeconds)
+	{
+		this->FinishSoak();
+	}
+}
+
+void AShooterSoakDriver::FinishSoak()
+{
+	this->bFinished = true;
+
+	for (AGameplayPlayerCharacter* Character : this->Characters)
+	{
+		if (Character)
+		{
+			Character->StopFireWeapon();
+		}
+	}
+
+	const int32 NumFrames = this->FrameTimesMs.Num();
+
+	float TotalMs = 0.0f;
+	for (float FrameMs : this->FrameTimesMs)
+	{
+		TotalMs += FrameMs;
+	}
+
+	this->FrameTimesMs.Sort();
+
+	const float AverageMs = NumFrames > 0 ? TotalMs / NumFrames : 0.0f;
+	const float P99Ms = NumFrames > 0 ? this->FrameTimesMs[FMath::Clamp(FMath::CeilToInt(NumFrames * 0.99f) - 1, 0, NumFrames - 1)] : 0.0f;
+	const float MaxMs = NumFrames > 0 ? this->FrameTimesMs.Last() : 0.0f;
+
+	const FPlatformMemoryStats MemoryStats = FPlatformMemory::GetStats();
+	const double MegaByte = 1024.0 * 1024.0;
+
+	const FString Report = FString::Printf(TEXT(
+		"{\n"
+		"\t\"characters\": %d,\n"
+		"\t\"measureSeconds\": %.2f,\n"
+		"\t\"frames\": %d,\n"
+		"\t\"avgGameThreadMs\": %.4f,\n"
+		"\t\"p99GameThreadMs\": %.4f,\n"
+		"\t\"maxGameThreadMs\": %.4f,\n"
+		"\t\"peakUsedPhysicalMB\": %.2f,\n"
+		"\t\"peakUsedVirtualMB\": %.2f,\n"
+		"\t\"processPeakUsedPhysicalMB\": %.2f\n"
+		"}\n"),
+		this->Characters.Num(),
+		this->MeasureSeconds,
+		NumFrames,
+		AverageMs,
+		P99Ms,
+		MaxMs,
+		this->PeakUsedPhysical / MegaByte,
+		this->PeakUsedVirtual / MegaByte,
+		MemoryStats.PeakUsedPhysical / MegaByte);
+
+	const FString ReportPath = FPaths::GameSavedDir() / TEXT("Soak") / FString::Printf(TEXT("Soak_%d_%s.json"), this->Characters.Num(), *FDateTime::Now().ToString());
+	if (FFileHelper::SaveStringToFile(Report, *ReportPath))
+	{
+		UE_LOG(LogTemp, Log, TEXT("ShooterSoakDriver:: avg %.3f ms, p99 %.3f ms over %d frames, report written to %s"), AverageMs, P99Ms, NumFrames, *ReportPath)
+	}
+	else
+	{
+		UE_LOG(LogTemp, Error, TEXT("ShooterSoakDriver:: could not write the report to %s"), *ReportPath)
+	}
+
+	if (this->bQuitWhenDone)
+	{
+		FPlatformMisc::RequestExit(false);
+	}
+}
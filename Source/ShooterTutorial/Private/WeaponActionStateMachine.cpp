@@ -0,0 +1,113 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "WeaponActionStateMachine.h"
+#include "BaseWeapon.h"
+
+#define REFUSE		{ EWeaponActionResult::WAR_Refuse, EWeaponActionState::WAS_Unarmed }
+#define BUFFER		{ EWeaponActionResult::WAR_Buffer, EWeaponActionState::WAS_Unarmed }
+#define EXECUTE(S)	{ EWeaponActionResult::WAR_Execute, EWeaponActionState::S }
+
+/* Rows are states, columns are inputs, both in enum order */
+static const FWeaponActionTransition WeaponActionTransitions[(int32)EWeaponActionState::WAS_Count][(int32)EWeaponActionInput::WAI_Count] =
+{
+	//				Fire					Reload						Equip						ReloadFinished			EquipFinished			Armed						Disarmed
+	/* Unarmed */	{ REFUSE,				REFUSE,						EXECUTE(WAS_Equipping),		REFUSE,					REFUSE,					EXECUTE(WAS_Idle),			EXECUTE(WAS_Unarmed) },
+	/* Idle */		{ EXECUTE(WAS_Idle),	EXECUTE(WAS_Reloading),		EXECUTE(WAS_Equipping),		REFUSE,					REFUSE,					EXECUTE(WAS_Idle),			EXECUTE(WAS_Unarmed) },
+	/* Reloading */	{ BUFFER,				REFUSE,						BUFFER,						EXECUTE(WAS_Idle),		REFUSE,					EXECUTE(WAS_Reloading),		EXECUTE(WAS_Unarmed) },
+	/* Equipping */	{ BUFFER,				BUFFER,						BUFFER,						REFUSE,					EXECUTE(WAS_Idle),		EXECUTE(WAS_Equipping),		EXECUTE(WAS_Unarmed) },
+};
+
+#undef REFUSE
+#undef BUFFER
+#undef EXECUTE
+
+FWeaponActionStateMachine::FWeaponActionStateMachine()
+	: State(EWeaponActionState::WAS_Unarmed)
+{
+	this->ClearBuffer();
+}
+
+const FWeaponActionTransition& FWeaponActionStateMachine::GetTransition(EWeaponActionState State, EWeaponActionInput Input)
+{
+	check(State < EWeaponActionState::WAS_Count && Input < EWeaponActionInput::WAI_Count);
+	return WeaponActionTransitions[(int32)State][(int32)Input];
+}
+
+EWeaponActionResult FWeaponActionStateMachine::HandleInput(EWeaponActionInput Input, float Time, ABaseWeapon* Weapon)
+{
+	const FWeaponActionTransition& Transition = GetTransition(this->State, Input);
+
+	switch (Transition.Result)
+	{
+		case EWeaponActionResult::WAR_Execute:
+			this->State = Transition.NextState;
+			break;
+
+		case EWeaponActionResult::WAR_Buffer:
+			// A newer press replaces the older one
+			check((int32)Input < NumBufferedWeaponInputs);
+			this->BufferedPressTimes[(int32)Input] = Time;
+			if (Input == EWeaponActionInput::WAI_Equip)
+			{
+				this->BufferedEquipWeapon = Weapon;
+			}
+			break;
+
+		default:
+			break;
+	}
+
+	return Transition.Result;
+}
+
+bool FWeaponActionStateMachine::PopReadyInput(float Time, float BufferTime, EWeaponActionInput& OutInput, ABaseWeapon*& OutWeapon)
+{
+	int32 ReadyInput = INDEX_NONE;
+
+	for (int32 Input = 0; Input < NumBufferedWeaponInputs; ++Input)
+	{
+		float& PressTime = this->BufferedPressTimes[Input];
+		if (PressTime < 0.0f)
+		{
+			continue;
+		}
+
+		if (Time - PressTime > BufferTime)
+		{
+			PressTime = -1.0f;
+			continue;
+		}
+
+		const bool bExecutes = GetTransition(this->State, (EWeaponActionInput)Input).Result == EWeaponActionResult::WAR_Execute;
+		if (bExecutes && (ReadyInput == INDEX_NONE || PressTime < this->BufferedPressTimes[ReadyInput]))
+		{
+			ReadyInput = Input;
+		}
+	}
+
+	if (ReadyInput == INDEX_NONE)
+	{
+		return false;
+	}
+
+	this->BufferedPressTimes[ReadyInput] = -1.0f;
+
+	OutInput = (EWeaponActionInput)ReadyInput;
+	OutWeapon = OutInput == EWeaponActionInput::WAI_Equip ? this->BufferedEquipWeapon.Get() : nullptr;
+	return true;
+}
+
+bool FWeaponActionStateMachine::IsBuffered(EWeaponActionInput Input) const
+{
+	return (int32)Input < NumBufferedWeaponInputs && this->BufferedPressTimes[(int32)Input] >= 0.0f;
+}
+
+void FWeaponActionStateMachine::ClearBuffer()
+{
+	for (float& PressTime : this->BufferedPressTimes)
+	{
+		PressTime = -1.0f;
+	}
+
+	this->BufferedEquipWeapon.Reset();
+}
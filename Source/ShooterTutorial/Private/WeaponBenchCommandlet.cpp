@@ -0,0 +1,299 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "WeaponBenchCommandlet.h"
+#include "HAL/MemoryBase.h"
+#include "Engine/World.h"
+#include "BaseWeapon.h"
+#include "GameplayPlayerCharacter.h"
+
+/* Allocations made by this thread since counting started, or negative while it is not counting */
+static thread_local int32 WeaponBenchThreadAllocations = -1;
+
+/**
+ * Forwards to the real allocator and counts the allocations of threads
+ * that are measuring. Installed over GMalloc once, the first time the bench
+ * runs, and never taken out again: other threads keep allocating through
+ * it without being counted and without racing a swap back.
+ */
+class FWeaponBenchCountingMalloc : public FMalloc
+{
+public:
+
+	explicit FWeaponBenchCountingMalloc(FMalloc* InInnerMalloc)
+		: InnerMalloc(InInnerMalloc)
+	{
+	}
+
+	/* Puts the counting allocator in place if it is not already */
+	static void Install()
+	{
+		static FWeaponBenchCountingMalloc* CountingMalloc = nullptr;
+		if (CountingMalloc == nullptr)
+		{
+			CountingMalloc = new FWeaponBenchCountingMalloc(GMalloc);
+			GMalloc = CountingMalloc;
+		}
+	}
+
+	virtual void* Malloc(SIZE_T Count, uint32 Alignment) override
+	{
+		CountAllocation();
+		return InnerMalloc->Malloc(Count, Alignment);
+	}
+
+	virtual void* Realloc(void* Original, SIZE_T Count, uint32 Alignment) override
+	{
+		CountAllocation();
+		return InnerMalloc->Realloc(Original, Count, Alignment);
+	}
+
+	virtual void Free(void* Original) override
+	{
+		InnerMalloc->Free(Original);
+	}
+
+	virtual bool GetAllocationSize(void* Original, SIZE_T& SizeOut) override
+	{
+		return InnerMalloc->GetAllocationSize(Original, SizeOut);
+	}
+
+	virtual SIZE_T QuantizeSize(SIZE_T Count, uint32 Alignment) override
+	{
+		return InnerMalloc->QuantizeSize(Count, Alignment);
+	}
+
+	virtual bool IsInternallyThreadSafe() const override
+	{
+		return InnerMalloc->IsInternallyThreadSafe();
+	}
+
+	virtual const TCHAR* GetDescriptiveName() override
+	{
+		return TEXT("WeaponBenchCountingMalloc");
+	}
+
+private:
+
+	/* Only the measuring thread pays for the count, and nobody shares it */
+	static FORCEINLINE void CountAllocation()
+	{
+		if (WeaponBenchThreadAllocations >= 0)
+		{
+			WeaponBenchThreadAllocations++;
+		}
+	}
+
+private:
+
+	/* The allocator doing the actual work */
+	FMalloc* InnerMalloc;
+};
+
+/* Counts the allocations of the calling thread for as long as it lives */
+struct FWeaponBenchAllocationScope
+{
+	FWeaponBenchAllocationScope()
+	{
+		WeaponBenchThreadAllocations = 0;
+	}
+
+	~FWeaponBenchAllocationScope()
+	{
+		WeaponBenchThreadAllocations = -1;
+	}
+
+	/* Allocations counted so far */
+	int32 GetNumAllocations() const
+	{
+		return WeaponBenchThreadAllocations;
+	}
+};
+
+/* Result of one benchmarked operation */
+struct FWeaponBenchResult
+{
+	FString Operation;
+	FString Dispatch;
+	double NanosecondsPerOp;
+	double AllocationsPerOp;
+};
+
+/* Keeps the optimizer from dropping calls whose results are otherwise unused */
+static volatile int32 WeaponBenchSink = 0;
+
+/* Times Iterations calls of Op and counts the allocations they make on this thread */
+template <typename OpType>
+static FWeaponBenchResult RunWeaponBench(const TCHAR* Operation, const TCHAR* Dispatch, int32 Iterations, OpType&& Op)
+{
+	// One untimed pass so lazily built caches are not measured
+	for (int32 Warmup = 0; Warmup < FMath::Min(Iterations, 1000); ++Warmup)
+	{
+		Op();
+	}
+
+	uint64 StartCycles = 0;
+	uint64 EndCycles = 0;
+	int32 NumAllocations = 0;
+	{
+		FWeaponBenchAllocationScope AllocationScope;
+		StartCycles = FPlatformTime::Cycles64();
+
+		for (int32 Iteration = 0; Iteration < Iterations; ++Iteration)
+		{
+			Op();
+		}
+
+		EndCycles = FPlatformTime::Cycles64();
+		NumAllocations = AllocationScope.GetNumAllocations();
+	}
+
+	FWeaponBenchResult Result;
+	Result.Operation = Operation;
+	Result.Dispatch = Dispatch;
+	Result.NanosecondsPerOp = (EndCycles - StartCycles) * FPlatformTime::GetSecondsPerCycle64() * 1.0e9 / Iterations;
+	Result.AllocationsPerOp = (double)NumAllocations / Iterations;
+	return Result;
+}
+
+UWeaponBenchCommandlet::UWeaponBenchCommandlet()
+{
+	IsClient = false;
+	IsEditor = false;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+int32 UWeaponBenchCommandlet::Main(const FString& Params)
+{
+	int32 Iterations = 1000000;
+	FParse::Value(*Params, TEXT("Iterations="), Iterations);
+	Iterations = FMath::Max(Iterations, 1);
+
+	// A bare world: no game state, so no gameplay managers and no shot emission is measured
+	UWorld* World = UWorld::CreateWorld(EWorldType::Game, false);
+	if (World == nullptr)
+	{
+		UE_LOG(LogTemp, Error, TEXT("WeaponBench:: could not create the bench world"))
+		return 1;
+	}
+
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	ABaseWeapon* Weapon = World->SpawnActor<ABaseWeapon>(ABaseWeapon::StaticClass(), FTransform::Identity, SpawnParameters);
+	AGameplayPlayerCharacter* Character = World->SpawnActor<AGameplayPlayerCharacter>(AGameplayPlayerCharacter::StaticClass(), FTransform::Identity, SpawnParameters);
+	if (Weapon == nullptr || Character == nullptr)
+	{
+		UE_LOG(LogTemp, Error, TEXT("WeaponBench:: could not spawn the bench actors"))
+		World->DestroyWorld(false);
+		return 1;
+	}
+
+	Weapon->ResetWeaponState();
+	TArray<FWeaponBackpackItem> BenchItems;
+	BenchItems.SetNum(8);
+	Character->BackpackInventory->SetItems(BenchItems);
+
+	// Plenty of ammo so no operation runs dry during the run
+	const auto RefillWeapon = [Weapon]()
+	{
+		Weapon->CurrentAmmoInMag = MAX_int32 / 2;
+		Weapon->CurrentAmmoInBackpack = MAX_int32 / 2;
+	};
+
+	UFunction* FireFunction = Weapon->FindFunctionChecked(TEXT("Fire"));
+	UFunction* ReloadFunction = Weapon->FindFunctionChecked(TEXT("Reload"));
+	UFunction* HaveAmmoInMagFunction = Weapon->FindFunctionChecked(TEXT("HaveAmmoInMag"));
+	UFunction* HaveAmmoInBackpackFunction = Weapon->FindFunctionChecked(TEXT("HaveAmmoInBackpack"));
+	UFunction* CanAddFunction = Character->FindFunctionChecked(TEXT("CanAddWeaponToWeaponSelected"));
+	UFunction* SetSelectedFunction = Character->FindFunctionChecked(TEXT("SetBackpackItemSelected"));
+
+	// Parameter blocks laid out the way the generated thunks lay them out
+	struct FHaveAmmoInMagParams { bool HaveAmmo; bool MagIsFull; };
+	struct FHaveAmmoInBackpackParams { bool HaveAmmo; };
+	struct FCanAddParams { int32 HowManyItemsSelected; bool ReturnValue; };
+	struct FSetSelectedParams { int32 BackPackItemIndex; bool bIsSelected; int32 WhichSlot; };
+
+	// The bench world has no hitscan manager; keep its warning out of the measurement
+	const ELogVerbosity::Type PreviousVerbosity = LogTemp.GetVerbosity();
+	LogTemp.SetVerbosity(ELogVerbosity::Error);
+
+	FWeaponBenchCountingMalloc::Install();
+
+	TArray<FWeaponBenchResult> Results;
+	int32 Step = 0;
+
+	RefillWeapon();
+	Results.Add(RunWeaponBench(TEXT("Fire"), TEXT("Native"), Iterations, [Weapon]() { Weapon->Fire_Implementation(); }));
+	Results.Add(RunWeaponBench(TEXT("Fire"), TEXT("Thunk"), Iterations, [Weapon]() { Weapon->Fire(); }));
+	Results.Add(RunWeaponBench(TEXT("Fire"), TEXT("ProcessEvent"), Iterations, [Weapon, FireFunction]() { Weapon->ProcessEvent(FireFunction, nullptr); }));
+
+	RefillWeapon();
+	Results.Add(RunWeaponBench(TEXT("Reload"), TEXT("Native"), Iterations, [Weapon]() { Weapon->Reload_Implementation(); }));
+	Results.Add(RunWeaponBench(TEXT("Reload"), TEXT("Thunk"), Iterations, [Weapon]() { Weapon->Reload(); }));
+	Results.Add(RunWeaponBench(TEXT("Reload"), TEXT("ProcessEvent"), Iterations, [Weapon, ReloadFunction]() { Weapon->ProcessEvent(ReloadFunction, nullptr); }));
+
+	RefillWeapon();
+	Results.Add(RunWeaponBench(TEXT("HaveAmmoInMag"), TEXT("Native"), Iterations, [Weapon]()
+	{
+		bool bHaveAmmo = false;
+		bool bMagIsFull = false;
+		Weapon->HaveAmmoInMag(bHaveAmmo, bMagIsFull);
+		WeaponBenchSink += bHaveAmmo + bMagIsFull;
+	}));
+	Results.Add(RunWeaponBench(TEXT("HaveAmmoInMag"), TEXT("ProcessEvent"), Iterations, [Weapon, HaveAmmoInMagFunction]()
+	{
+		FHaveAmmoInMagParams Parms = { false, false };
+		Weapon->ProcessEvent(HaveAmmoInMagFunction, &Parms);
+		WeaponBenchSink += Parms.HaveAmmo + Parms.MagIsFull;
+	}));
+
+	Results.Add(RunWeaponBench(TEXT("HaveAmmoInBackpack"), TEXT("Native"), Iterations, [Weapon]()
+	{
+		bool bHaveAmmo = false;
+		Weapon->HaveAmmoInBackpack(bHaveAmmo);
+		WeaponBenchSink += bHaveAmmo;
+	}));
+	Results.Add(RunWeaponBench(TEXT("HaveAmmoInBackpack"), TEXT("ProcessEvent"), Iterations, [Weapon, HaveAmmoInBackpackFunction]()
+	{
+		FHaveAmmoInBackpackParams Parms = { false };
+		Weapon->ProcessEvent(HaveAmmoInBackpackFunction, &Parms);
+		WeaponBenchSink += Parms.HaveAmmo;
+	}));
+
+	Results.Add(RunWeaponBench(TEXT("CanAddWeaponToWeaponSelected"), TEXT("Native"), Iterations, [Character]()
+	{
+		int32 HowManyItemsSelected = 0;
+		WeaponBenchSink += Character->CanAddWeaponToWeaponSelected(HowManyItemsSelected) + HowManyItemsSelected;
+	}));
+	Results.Add(RunWeaponBench(TEXT("CanAddWeaponToWeaponSelected"), TEXT("ProcessEvent"), Iterations, [Character, CanAddFunction]()
+	{
+		FCanAddParams Parms = { 0, false };
+		Character->ProcessEvent(CanAddFunction, &Parms);
+		WeaponBenchSink += Parms.ReturnValue + Parms.HowManyItemsSelected;
+	}));
+
+	Results.Add(RunWeaponBench(TEXT("SetBackpackItemSelected"), TEXT("Native"), Iterations, [Character, &Step]()
+	{
+		const int32 ItemIndex = Step++ & 7;
+		Character->SetBackpackItemSelected(ItemIndex, (ItemIndex & 1) != 0, ItemIndex & 3);
+	}));
+	Results.Add(RunWeaponBench(TEXT("SetBackpackItemSelected"), TEXT("ProcessEvent"), Iterations, [Character, SetSelectedFunction, &Step]()
+	{
+		const int32 ItemIndex = Step++ & 7;
+		FSetSelectedParams Parms = { ItemIndex, (ItemIndex & 1) != 0, ItemIndex & 3 };
+		Character->ProcessEvent(SetSelectedFunction, &Parms);
+	}));
+
+	LogTemp.SetVerbosity(PreviousVerbosity);
+
+	UE_LOG(LogTemp, Display, TEXT("WeaponBench:: %d iterations per operation"), Iterations)
+	UE_LOG(LogTemp, Display, TEXT("WeaponBench:: %-30s %-14s %12s %12s"), TEXT("Operation"), TEXT("Dispatch"), TEXT("ns/op"), TEXT("allocs/op"))
+	for (const FWeaponBenchResult& Result : Results)
+	{
+		UE_LOG(LogTemp, Display, TEXT("WeaponBench:: %-30s %-14s %12.2f %12.4f"), *Result.Operation, *Result.Dispatch, Result.NanosecondsPerOp, Result.AllocationsPerOp)
+	}
+
+	World->DestroyWorld(false);
+	return 0;
+}
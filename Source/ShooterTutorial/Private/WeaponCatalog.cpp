@@ -0,0 +1,128 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "WeaponCatalog.h"
+#include "Engine/World.h"
+#include "ShooterGameInstance.h"
+
+namespace
+{
+	void RebakeWeaponCatalog(UWorld* World)
+	{
+		UWeaponCatalog* WeaponCatalog = UWeaponCatalog::Get(World);
+		if (WeaponCatalog == nullptr)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("RebakeWeaponCatalog:: there is no weapon catalog loaded"))
+			return;
+		}
+
+		WeaponCatalog->Bake();
+	}
+
+	FAutoConsoleCommandWithWorld RebakeWeaponCatalogCommand(
+		TEXT("Shooter.RebakeWeaponCatalog"),
+		TEXT("Rebuilds the weapon catalog from its data table so balancing changes apply without a restart"),
+		FConsoleCommandWithWorldDelegate::CreateStatic(&RebakeWeaponCatalog));
+}
+
+UWeaponCatalog* UWeaponCatalog::Get(const UWorld* World)
+{
+	if (World == nullptr)
+	{
+		return nullptr;
+	}
+
+	UShooterGameInstance* GameInstance = Cast<UShooterGameInstance>(World->GetGameInstance());
+	return GameInstance ? GameInstance->GetWeaponCatalog() : nullptr;
+}
+
+void UWeaponCatalog::Bake()
+{
+	this->BakedIds.Reset();
+	this->BakedStats.Reset();
+
+	if (this->SourceTable == nullptr)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Bake:: SourceTable was not setup in editor"))
+		this->BuildIndex();
+		return;
+	}
+
+	if (this->SourceTable->RowStruct == nullptr || !this->SourceTable->RowStruct->IsChildOf(FWeaponStats::StaticStruct()))
+	{
+		UE_LOG(LogTemp, Error, TEXT("Bake:: SourceTable rows are not FWeaponStats"))
+		this->BuildIndex();
+		return;
+	}
+
+	// Sorted ids keep weapon indices stable between bakes
+	TArray<FName> RowNames = this->SourceTable->GetRowNames();
+	RowNames.Sort(FNameLexicalLess());
+
+	this->BakedIds.Reserve(RowNames.Num());
+	this->BakedStats.Reserve(RowNames.Num());
+
+	static const FString ContextString(TEXT("UWeaponCatalog::Bake"));
+	for (const FName& RowName : RowNames)
+	{
+		const FWeaponStats* Row = this->SourceTable->FindRow<FWeaponStats>(RowName, ContextString);
+		if (Row)
+		{
+			this->BakedIds.Add(RowName);
+			this->BakedStats.Add(*Row);
+		}
+	}
+
+	this->BuildIndex();
+}
+
+int32 UWeaponCatalog::FindWeaponIndex(FName WeaponId) const
+{
+	const int32* WeaponIndex = this->IdToIndex.Find(WeaponId);
+	return WeaponIndex ? *WeaponIndex : INDEX_NONE;
+}
+
+void UWeaponCatalog::PostLoad()
+{
+	Super::PostLoad();
+
+#if WITH_EDITOR
+	// In the editor the table may have changed since the catalog was saved
+	if (this->SourceTable)
+	{
+		this->SourceTable->ConditionalPostLoad();
+		this->Bake();
+		return;
+	}
+#endif
+
+	this->BuildIndex();
+}
+
+void UWeaponCatalog::PreSave(const class ITargetPlatform* TargetPlatform)
+{
+	Super::PreSave(TargetPlatform);
+
+	// Saving or cooking always writes a fresh bake
+	this->Bake();
+}
+
+#if WITH_EDITOR
+void UWeaponCatalog::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+
+	this->Bake();
+}
+#endif
+
+void UWeaponCatalog::BuildIndex()
+{
+	this->IdToIndex.Reset();
+	this->IdToIndex.Reserve(this->BakedIds.Num());
+	this->BakeVersion++;
+
+	for (int32 Index = 0; Index < this->BakedIds.Num(); ++Index)
+	{
+		this->IdToIndex.Add(this->BakedIds[Index], Index);
+	}
+}
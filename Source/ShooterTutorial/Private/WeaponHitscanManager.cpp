@@ -0,0 +1,146 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "WeaponHitscanManager.h"
+#include "Engine/World.h"
+#include "BaseWeapon.h"
+#include "GameplayGameState.h"
+#include "LagCompensationManager.h"
+#include "ShooterTutorial.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Hitscan Rays Traced"), STAT_ShooterHitscanRaysTraced, STATGROUP_ShooterTutorial);
+DECLARE_MEMORY_STAT(TEXT("Hitscan Shot Queues"), STAT_ShooterHitscanMemory, STATGROUP_ShooterTutorial);
+
+UWeaponHitscanManager* UWeaponHitscanManager::Get(const UWorld* World)
+{
+	if (World == nullptr)
+	{
+		return nullptr;
+	}
+
+	AGameplayGameState* GameState = World->GetGameState<AGameplayGameState>();
+	return GameState ? GameState->GetHitscanManager() : nullptr;
+}
+
+UWeaponHitscanManager::UWeaponHitscanManager()
+{
+	this->TraceDelegate.BindUObject(this, &UWeaponHitscanManager::OnTraceCompleted);
+}
+
+void UWeaponHitscanManager::QueueShot(ABaseWeapon* Weapon, const FVector& Start, const FVector& End, ECollisionChannel Channel, float Timestamp)
+{
+	if (Weapon == nullptr)
+	{
+		UE_LOG(LogTemp, Error, TEXT("QueueShot:: Weapon is null or empty"))
+		return;
+	}
+
+	FHitscanShot Shot;
+	Shot.Weapon = Weapon;
+	Shot.Start = Start;
+	Shot.End = End;
+	Shot.Timestamp = Timestamp;
+	Shot.Channel = Channel;
+
+	this->QueuedShots.Add(Shot);
+}
+
+void UWeaponHitscanManager::FlushQueuedShots()
+{
+	UWorld* World = GetWorld();
+	if (World == nullptr || this->QueuedShots.Num() == 0)
+	{
+		return;
+	}
+
+	static const FName HitscanTraceTag(TEXT("WeaponHitscan"));
+
+	// Only the server records history; clients trace their cosmetic shots against the world as it is
+	ULagCompensationManager* LagCompensation = ULagCompensationManager::Get(World);
+	const bool bRewindCharacters = LagCompensation && LagCompensation->GetNumTargets() > 0;
+
+	TArray<AActor*> RewoundActors;
+	if (bRewindCharacters)
+	{
+		LagCompensation->GetTargetActors(RewoundActors);
+	}
+
+	for (FHitscanShot& Shot : this->QueuedShots)
+	{
+		ABaseWeapon* Weapon = Shot.Weapon.Get();
+		if (Weapon == nullptr)
+		{
+			continue;
+		}
+
+		// Never hit the weapon itself or whoever is holding it
+		FCollisionQueryParams QueryParams(HitscanTraceTag, false, Weapon);
+		QueryParams.AddIgnoredActor(Weapon->GetOwner());
+
+		if (bRewindCharacters)
+		{
+			QueryParams.AddIgnoredActors(RewoundActors);
+			Shot.bHasRewoundHit = LagCompensation->RewindLineTrace(Shot.Timestamp, Shot.Start, Shot.End, Weapon->GetOwner(), Shot.RewoundHit);
+		}
+
+		// The sparse index travels with the trace so the result can find its shot again
+		const int32 ShotIndex = this->InFlightShots.Add(Shot);
+
+		INC_DWORD_STAT(STAT_ShooterHitscanRaysTraced);
+		World->AsyncLineTraceByChannel(EAsyncTraceType::Single, Shot.Start, Shot.End, Shot.Channel, QueryParams, FCollisionResponseParams::DefaultResponseParam, &this->TraceDelegate, (uint32)ShotIndex);
+	}
+
+	this->QueuedShots.Reset();
+}
+
+void UWeaponHitscanManager::OnTraceCompleted(const FTraceHandle& TraceHandle, FTraceDatum& TraceDatum)
+{
+	const int32 ShotIndex = (int32)TraceDatum.UserData;
+	if (!this->InFlightShots.IsValidIndex(ShotIndex))
+	{
+		UE_LOG(LogTemp, Error, TEXT("OnTraceCompleted:: trace result does not match any in flight shot"))
+		return;
+	}
+
+	const FHitscanShot Shot = this->InFlightShots[ShotIndex];
+	this->InFlightShots.RemoveAt(ShotIndex);
+
+	ABaseWeapon* Weapon = Shot.Weapon.Get();
+	if (Weapon == nullptr)
+	{
+		// The weapon went away while its shot was in flight
+		return;
+	}
+
+	// A character in front of the world geometry takes the shot
+	if (Shot.bHasRewoundHit && (TraceDatum.OutHits.Num() == 0 || Shot.RewoundHit.Distance < TraceDatum.OutHits[0].Distance))
+	{
+		Weapon->OnHitscanResolved(Shot, Shot.RewoundHit);
+	}
+	else if (TraceDatum.OutHits.Num() > 0)
+	{
+		Weapon->OnHitscanResolved(Shot, TraceDatum.OutHits[0]);
+	}
+	else
+	{
+		// Nothing was hit; report a non blocking result at the end of the ray
+		FHitResult MissResult(1.0f);
+		MissResult.TraceStart = Shot.Start;
+		MissResult.TraceEnd = Shot.End;
+		MissResult.Location = Shot.End;
+		MissResult.ImpactPoint = Shot.End;
+		Weapon->OnHitscanResolved(Shot, MissResult);
+	}
+}
+
+void UWeaponHitscanManager::Tick(float DeltaTime)
+{
+	// Ticked after every actor of the frame, so all shots are queued by now
+	this->FlushQueuedShots();
+
+	SET_MEMORY_STAT(STAT_ShooterHitscanMemory, this->QueuedShots.GetAllocatedSize() + this->InFlightShots.GetAllocatedSize());
+}
+
+TStatId UWeaponHitscanManager::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UWeaponHitscanManager, STATGROUP_ShooterTutorial);
+}
@@ -0,0 +1,108 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "WeaponPool.h"
+#include "Engine/World.h"
+#include "GameplayGameState.h"
+
+UWeaponPool* UWeaponPool::Get(const UWorld* World)
+{
+	if (World == nullptr)
+	{
+		return nullptr;
+	}
+
+	AGameplayGameState* GameState = World->GetGameState<AGameplayGameState>();
+	return GameState ? GameState->GetWeaponPool() : nullptr;
+}
+
+ABaseWeapon* UWeaponPool::CheckOut(TSubclassOf<ABaseWeapon> WeaponClass, APawn* NewOwner, USceneComponent* AttachParent)
+{
+	if (!WeaponClass)
+	{
+		UE_LOG(LogTemp, Error, TEXT("CheckOut:: WeaponClass is null or empty"))
+		return nullptr;
+	}
+
+	FWeaponPoolBucket& Bucket = this->Buckets.FindOrAdd(WeaponClass.Get());
+
+	ABaseWeapon* Weapon = nullptr;
+	while (Weapon == nullptr && Bucket.FreeWeapons.Num() > 0)
+	{
+		// Something outside the pool may have destroyed a pooled weapon
+		Weapon = Bucket.FreeWeapons.Pop(false);
+		if (Weapon && Weapon->IsPendingKill())
+		{
+			Weapon = nullptr;
+		}
+	}
+
+	if (Weapon)
+	{
+		Weapon->SetOwner(NewOwner);
+		Weapon->Instigator = NewOwner;
+		Weapon->ResetWeaponState();
+		Weapon->SetHolstered(false);
+	}
+	else
+	{
+		FActorSpawnParameters SpawnParameters;
+		SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+		SpawnParameters.Owner = NewOwner;
+		SpawnParameters.Instigator = NewOwner;
+
+		const FTransform SpawnTransform = NewOwner ? NewOwner->GetTransform() : FTransform::Identity;
+		Weapon = GetWorld()->SpawnActor<ABaseWeapon>(WeaponClass.Get(), SpawnTransform, SpawnParameters);
+		if (Weapon == nullptr)
+		{
+			UE_LOG(LogTemp, Error, TEXT("CheckOut:: could not spawn a weapon of class %s"), *GetNameSafe(WeaponClass.Get()))
+			return nullptr;
+		}
+	}
+
+	if (AttachParent)
+	{
+		Weapon->AttachToComponent(AttachParent, FAttachmentTransformRules(EAttachmentRule::SnapToTarget, false), Weapon->GetAttachSocketNameFPP());
+	}
+
+	return Weapon;
+}
+
+void UWeaponPool::CheckIn(ABaseWeapon* Weapon)
+{
+	if (Weapon == nullptr || Weapon->IsPendingKill())
+	{
+		UE_LOG(LogTemp, Error, TEXT("CheckIn:: Weapon is null or empty"))
+		return;
+	}
+
+	FWeaponPoolBucket& Bucket = this->Buckets.FindOrAdd(Weapon->GetClass());
+	if (Bucket.FreeWeapons.Contains(Weapon))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("CheckIn:: Weapon was already checked in"))
+		return;
+	}
+
+	// Nobody needs to see, tick or hear about a weapon waiting in the pool
+	Weapon->SetHolstered(true);
+	Weapon->SetOwner(nullptr);
+	Weapon->Instigator = nullptr;
+
+	// Whoever listened to this weapon does not own it anymore
+	Weapon->OnHitscanResolvedDelegate.Clear();
+	Weapon->OnTriggerShotDelegate.Unbind();
+	Weapon->OnShotEmittedDelegate.Unbind();
+
+	Bucket.FreeWeapons.Add(Weapon);
+}
+
+int32 UWeaponPool::GetNumFreeWeapons(TSubclassOf<ABaseWeapon> WeaponClass) const
+{
+	const FWeaponPoolBucket* Bucket = this->Buckets.Find(WeaponClass.Get());
+	return Bucket ? Bucket->FreeWeapons.Num() : 0;
+}
+
+bool UWeaponPool::IsTickable() const
+{
+	// The pool only reacts to CheckOut and CheckIn calls
+	return false;
+}
@@ -0,0 +1,357 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "WeaponStateStore.h"
+#include "Async/ParallelFor.h"
+#include "Engine/World.h"
+#include "BaseWeapon.h"
+#include "GameplayGameState.h"
+#include "ShooterTutorial.h"
+
+DECLARE_CYCLE_STAT(TEXT("Weapon State Store Simulate"), STAT_ShooterStoreSimulate, STATGROUP_ShooterTutorial);
+DECLARE_CYCLE_STAT(TEXT("Weapon State Store SyncViews"), STAT_ShooterStoreSyncViews, STATGROUP_ShooterTutorial);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Weapon Agents Simulated"), STAT_ShooterStoreAgentsSimulated, STATGROUP_ShooterTutorial);
+DECLARE_MEMORY_STAT(TEXT("Weapon State Store"), STAT_ShooterStoreMemory, STATGROUP_ShooterTutorial);
+
+static TAutoConsoleVariable<int32> CVarWeaponStateStore(
+	TEXT("Shooter.WeaponStateStore"),
+	0,
+	TEXT("If 1, weapons spawned from now on keep their ammo and fire state in the world's weapon state store."),
+	ECVF_Default);
+
+/* How many agents a worker simulates in one go */
+static const int32 WeaponStateStoreBatchSize = 1024;
+
+UWeaponStateStore* UWeaponStateStore::Get(const UWorld* World)
+{
+	if (World == nullptr)
+	{
+		return nullptr;
+	}
+
+	AGameplayGameState* GameState = World->GetGameState<AGameplayGameState>();
+	return GameState ? GameState->GetWeaponStateStore() : nullptr;
+}
+
+bool UWeaponStateStore::IsEnabled()
+{
+	return CVarWeaponStateStore.GetValueOnGameThread() != 0;
+}
+
+int32 UWeaponStateStore::AddAgent(const FWeaponAgentDesc& Desc, ABaseWeapon* View)
+{
+	int32 Handle = INDEX_NONE;
+	if (this->FreeHandles.Num() > 0)
+	{
+		Handle = this->FreeHandles.Pop(false);
+	}
+	else
+	{
+		Handle = this->Flags.Num();
+
+		this->AmmoInMag.AddUninitialized();
+		this->AmmoInBackpack.AddUninitialized();
+		this->MaxAmmoInMag.AddUninitialized();
+		this->MaxAmmoInBackpack.AddUninitialized();
+		this->ReloadTime.AddUninitialized();
+		this->FireInterval.AddUninitialized();
+		this->ReloadRemaining.AddUninitialized();
+		this->CooldownRemaining.AddUninitialized();
+		this->Flags.AddUninitialized();
+		this->PendingShots.AddUninitialized();
+		this->ShotsFired.AddUninitialized();
+		this->Views.AddDefaulted();
+	}
+
+	this->Views[Handle] = View;
+	this->ResetAgent(Handle, Desc);
+
+	return Handle;
+}
+
+void UWeaponStateStore::ResetAgent(int32 Handle, const FWeaponAgentDesc& Desc)
+{
+	if (!this->Flags.IsValidIndex(Handle))
+	{
+		UE_LOG(LogTemp, Error, TEXT("ResetAgent:: Handle %d is out of range"), Handle)
+		return;
+	}
+
+	this->MaxAmmoInMag[Handle] = Desc.MaxAmmoInMag;
+	this->MaxAmmoInBackpack[Handle] = Desc.MaxAmmoInBackpack;
+	this->ReloadTime[Handle] = Desc.ReloadTime;
+	this->FireInterval[Handle] = Desc.FireInterval;
+
+	// Full magazine and backpack filled with ammo
+	this->AmmoInMag[Handle] = Desc.MaxAmmoInMag;
+	this->AmmoInBackpack[Handle] = Desc.MaxAmmoInBackpack;
+
+	this->ReloadRemaining[Handle] = 0.0f;
+	this->CooldownRemaining[Handle] = 0.0f;
+	this->Flags[Handle] = EWeaponAgentFlags::Alive | EWeaponAgentFlags::CanFire;
+	if (this->Views[Handle].IsValid())
+	{
+		this->Flags[Handle] |= EWeaponAgentFlags::ManualReload;
+	}
+	this->PendingShots[Handle] = 0;
+	this->ShotsFired[Handle] = 0;
+}
+
+void UWeaponStateStore::RemoveAgent(int32 Handle)
+{
+	if (!this->IsValidAgent(Handle))
+	{
+		UE_LOG(LogTemp, Error, TEXT("RemoveAgent:: Handle %d is not a live agent"), Handle)
+		return;
+	}
+
+	this->Flags[Handle] = 0;
+	this->Views[Handle] = nullptr;
+	this->FreeHandles.Add(Handle);
+}
+
+void UWeaponStateStore::RequestFire(int32 Handle)
+{
+	if (this->IsValidAgent(Handle) && this->PendingShots[Handle] < MAX_uint8)
+	{
+		this->PendingShots[Handle]++;
+	}
+}
+
+void UWeaponStateStore::SetTriggerHeld(int32 Handle, bool bHeld)
+{
+	if (!this->IsValidAgent(Handle))
+	{
+		return;
+	}
+
+	if (bHeld)
+	{
+		this->Flags[Handle] |= EWeaponAgentFlags::TriggerHeld;
+	}
+	else
+	{
+		this->Flags[Handle] &= ~EWeaponAgentFlags::TriggerHeld;
+	}
+}
+
+void UWeaponStateStore::RequestReload(int32 Handle)
+{
+	if (this->IsValidAgent(Handle))
+	{
+		this->Flags[Handle] |= EWeaponAgentFlags::WantsReload;
+	}
+}
+
+void UWeaponStateStore::ApplyReload(int32 Handle)
+{
+	if (!this->IsValidAgent(Handle))
+	{
+		return;
+	}
+
+	// Same rule as ABaseWeapon::Reload: the magazine is refilled from the backpack
+	const int32 MinAmmo = FMath::Min<int32>(this->AmmoInBackpack[Handle], this->MaxAmmoInMag[Handle]);
+	this->AmmoInMag[Handle] = MinAmmo;
+	this->AmmoInBackpack[Handle] -= MinAmmo;
+
+	uint8& AgentFlag = this->Flags[Handle];
+	AgentFlag &= ~(EWeaponAgentFlags::Reloading | EWeaponAgentFlags::WantsReload);
+	this->ReloadRemaining[Handle] = 0.0f;
+
+	if ((AgentFlag & EWeaponAgentFlags::ChangingWeapon) == 0)
+	{
+		AgentFlag |= EWeaponAgentFlags::CanFire;
+	}
+}
+
+void UWeaponStateStore::SetChangingWeapon(int32 Handle, bool bChangingWeapon)
+{
+	if (!this->IsValidAgent(Handle))
+	{
+		return;
+	}
+
+	if (bChangingWeapon)
+	{
+		this->Flags[Handle] |= EWeaponAgentFlags::ChangingWeapon;
+		this->Flags[Handle] &= ~EWeaponAgentFlags::CanFire;
+	}
+	else
+	{
+		this->Flags[Handle] &= ~EWeaponAgentFlags::ChangingWeapon;
+		if ((this->Flags[Handle] & EWeaponAgentFlags::Reloading) == 0)
+		{
+			this->Flags[Handle] |= EWeaponAgentFlags::CanFire;
+		}
+	}
+}
+
+void UWeaponStateStore::Simulate(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_ShooterStoreSimulate);
+
+	const int32 NumAgents = this->Flags.Num();
+	INC_DWORD_STAT_BY(STAT_ShooterStoreAgentsSimulated, NumAgents);
+
+	if (NumAgents == 0)
+	{
+		return;
+	}
+
+	// Every agent only touches its own slots, so batches never share a write
+	const int32 NumBatches = FMath::DivideAndRoundUp(NumAgents, WeaponStateStoreBatchSize);
+	ParallelFor(NumBatches, [this, NumAgents, DeltaTime](int32 BatchIndex)
+	{
+		const int32 BeginIndex = BatchIndex * WeaponStateStoreBatchSize;
+		const int32 EndIndex = FMath::Min(BeginIndex + WeaponStateStoreBatchSize, NumAgents);
+		this->SimulateRange(BeginIndex, EndIndex, DeltaTime);
+	}, NumBatches == 1);
+}
+
+void UWeaponStateStore::SimulateRange(int32 BeginIndex, int32 EndIndex, float DeltaTime)
+{
+	int32* RESTRICT Mag = this->AmmoInMag.GetData();
+	int32* RESTRICT Backpack = this->AmmoInBackpack.GetData();
+	const int32* RESTRICT MaxMag = this->MaxAmmoInMag.GetData();
+	const float* RESTRICT Reload = this->ReloadTime.GetData();
+	const float* RESTRICT Interval = this->FireInterval.GetData();
+	float* RESTRICT ReloadLeft = this->ReloadRemaining.GetData();
+	float* RESTRICT CooldownLeft = this->CooldownRemaining.GetData();
+	uint8* RESTRICT AgentFlags = this->Flags.GetData();
+	uint8* RESTRICT Pending = this->PendingShots.GetData();
+	uint8* RESTRICT Fired = this->ShotsFired.GetData();
+
+	for (int32 Index = BeginIndex; Index < EndIndex; ++Index)
+	{
+		uint8 AgentFlag = AgentFlags[Index];
+		Fired[Index] = 0;
+
+		if ((AgentFlag & EWeaponAgentFlags::Alive) == 0)
+		{
+			continue;
+		}
+
+		CooldownLeft[Index] = FMath::Max(CooldownLeft[Index] - DeltaTime, 0.0f);
+
+		// Finish a running reload
+		if (AgentFlag & EWeaponAgentFlags::Reloading)
+		{
+			ReloadLeft[Index] -= DeltaTime;
+			if (ReloadLeft[Index] <= 0.0f)
+			{
+				const int32 MinAmmo = FMath::Min<int32>(Backpack[Index], MaxMag[Index]);
+				Mag[Index] = MinAmmo;
+				Backpack[Index] -= MinAmmo;
+
+				AgentFlag &= ~EWeaponAgentFlags::Reloading;
+				if ((AgentFlag & EWeaponAgentFlags::ChangingWeapon) == 0)
+				{
+					AgentFlag |= EWeaponAgentFlags::CanFire;
+				}
+			}
+		}
+
+		const bool bCanReload = (AgentFlag & (EWeaponAgentFlags::Reloading | EWeaponAgentFlags::ManualReload)) == 0 && Backpack[Index] > 0;
+		bool bStartReload = (AgentFlag & EWeaponAgentFlags::WantsReload) != 0 && bCanReload && Mag[Index] < MaxMag[Index];
+
+		// Fire as many of the requested shots as ammo and cooldown allow
+		const bool bWantsFire = Pending[Index] > 0 || (AgentFlag & EWeaponAgentFlags::TriggerHeld) != 0;
+		if (!bStartReload && bWantsFire && (AgentFlag & EWeaponAgentFlags::CanFire))
+		{
+			int32 ShotsLeft = (AgentFlag & EWeaponAgentFlags::TriggerHeld) ? MAX_uint8 : Pending[Index];
+			while (ShotsLeft > 0 && CooldownLeft[Index] <= 0.0f && Mag[Index] > 0)
+			{
+				Mag[Index]--;
+				Fired[Index]++;
+				CooldownLeft[Index] += Interval[Index];
+				ShotsLeft--;
+
+				// Without an interval only the requested shots are fired
+				if (Interval[Index] <= 0.0f && (AgentFlag & EWeaponAgentFlags::TriggerHeld))
+				{
+					break;
+				}
+			}
+
+			// An empty magazine reloads itself, like AGameplayPlayerCharacter::FireWeapon, even if it was full this frame
+			bStartReload = Mag[Index] == 0 && bCanReload;
+		}
+
+		if (bStartReload)
+		{
+			AgentFlag |= EWeaponAgentFlags::Reloading;
+			AgentFlag &= ~EWeaponAgentFlags::CanFire;
+			ReloadLeft[Index] = Reload[Index];
+		}
+
+		AgentFlag &= ~EWeaponAgentFlags::WantsReload;
+		AgentFlags[Index] = AgentFlag;
+		Pending[Index] = 0;
+	}
+}
+
+void UWeaponStateStore::SyncViews()
+{
+	for (int32 Handle = 0; Handle < this->Views.Num(); ++Handle)
+	{
+		ABaseWeapon* View = this->Views[Handle].Get();
+		if (View == nullptr)
+		{
+			continue;
+		}
+
+		if (View->CurrentAmmoInMag != this->AmmoInMag[Handle] || View->CurrentAmmoInBackpack != this->AmmoInBackpack[Handle])
+		{
+			View->CurrentAmmoInMag = this->AmmoInMag[Handle];
+			View->CurrentAmmoInBackpack = this->AmmoInBackpack[Handle];
+			View->MarkAmmoDirty();
+		}
+
+		for (int32 Shot = 0; Shot < this->ShotsFired[Handle]; ++Shot)
+		{
+			View->EmitShot();
+		}
+
+		// Requests the batch refused are gone, and so are their timestamps
+		View->ClearPendingShotTimestamps();
+	}
+}
+
+void UWeaponStateStore::Tick(float DeltaTime)
+{
+	this->Simulate(DeltaTime);
+
+	{
+		SCOPE_CYCLE_COUNTER(STAT_ShooterStoreSyncViews);
+		this->SyncViews();
+	}
+
+	SET_MEMORY_STAT(STAT_ShooterStoreMemory, this->GetAllocatedSize());
+}
+
+SIZE_T UWeaponStateStore::GetAllocatedSize() const
+{
+	return this->AmmoInMag.GetAllocatedSize()
+		+ this->AmmoInBackpack.GetAllocatedSize()
+		+ this->MaxAmmoInMag.GetAllocatedSize()
+		+ this->MaxAmmoInBackpack.GetAllocatedSize()
+		+ this->ReloadTime.GetAllocatedSize()
+		+ this->FireInterval.GetAllocatedSize()
+		+ this->ReloadRemaining.GetAllocatedSize()
+		+ this->CooldownRemaining.GetAllocatedSize()
+		+ this->Flags.GetAllocatedSize()
+		+ this->PendingShots.GetAllocatedSize()
+		+ this->ShotsFired.GetAllocatedSize()
+		+ this->Views.GetAllocatedSize()
+		+ this->FreeHandles.GetAllocatedSize();
+}
+
+bool UWeaponStateStore::IsTickable() const
+{
+	return this->Flags.Num() > this->FreeHandles.Num() && Super::IsTickable();
+}
+
+TStatId UWeaponStateStore::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UWeaponStateStore, STATGROUP_ShooterTutorial);
+}
@@ -0,0 +1,242 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "WeaponTimelineScheduler.h"
+#include "Engine/World.h"
+#include "GameplayGameState.h"
+#include "GameplayPlayerCharacter.h"
+#include "ShooterTutorial.h"
+
+DECLARE_CYCLE_STAT(TEXT("Bake Weapon Curve"), STAT_ShooterBakeCurve, STATGROUP_ShooterTutorial);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Weapon Timelines Advanced"), STAT_ShooterTimelinesAdvanced, STATGROUP_ShooterTutorial);
+DECLARE_MEMORY_STAT(TEXT("Weapon Timelines"), STAT_ShooterTimelineMemory, STATGROUP_ShooterTutorial);
+DECLARE_MEMORY_STAT(TEXT("Baked Weapon Curves"), STAT_ShooterBakedCurveMemory, STATGROUP_ShooterTutorial);
+
+UWeaponTimelineScheduler* UWeaponTimelineScheduler::Get(const UWorld* World)
+{
+	if (World == nullptr)
+	{
+		return nullptr;
+	}
+
+	AGameplayGameState* GameState = World->GetGameState<AGameplayGameState>();
+	return GameState ? GameState->GetWeaponTimelineScheduler() : nullptr;
+}
+
+void UWeaponTimelineScheduler::Play(AGameplayPlayerCharacter* Character, EWeaponTimelineType Type, UCurveFloat* Curve, float EventTime)
+{
+	if (Character == nullptr)
+	{
+		UE_LOG(LogTemp, Error, TEXT("Play:: Character is null or empty"))
+		return;
+	}
+
+	int32 Index = this->FindTimeline(Character, Type);
+	if (Index == INDEX_NONE)
+	{
+		Index = this->ActiveTimelines.AddDefaulted();
+	}
+
+	FActiveWeaponTimeline& Timeline = this->ActiveTimelines[Index];
+	Timeline.Character = Character;
+	Timeline.Curve = Curve;
+	Timeline.BakedCurve = this->BakeCurve(Curve);
+	Timeline.Type = Type;
+	Timeline.Position = 0.0f;
+	Timeline.EventTime = EventTime;
+	Timeline.bEventFired = false;
+
+	// The timeline lasts as long as its curve
+	float MinTime = 0.0f;
+	float MaxTime = 0.0f;
+	if (Curve)
+	{
+		Curve->GetTimeRange(MinTime, MaxTime);
+	}
+	Timeline.Length = FMath::Max(MaxTime, EventTime);
+}
+
+int32 UWeaponTimelineScheduler::BakeCurve(UCurveFloat* Curve)
+{
+	if (Curve == nullptr)
+	{
+		return INDEX_NONE;
+	}
+
+	const int32 ExistingIndex = this->BakedCurveAssets.Find(Curve);
+	if (ExistingIndex != INDEX_NONE)
+	{
+		return ExistingIndex;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_ShooterBakeCurve);
+
+	// Double the rate until the table is close enough to the curve or as big as we allow
+	FBakedWeaponCurve BakedCurve;
+	float SampleRate = this->BakeSampleRate;
+	float MaxError = SampleCurve(Curve, SampleRate, this->MaxBakedSamples, BakedCurve);
+	while (MaxError > this->BakeTolerance && BakedCurve.Samples.Num() < this->MaxBakedSamples)
+	{
+		SampleRate *= 2.0f;
+		MaxError = SampleCurve(Curve, SampleRate, this->MaxBakedSamples, BakedCurve);
+	}
+
+	if (MaxError > this->BakeTolerance)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("BakeCurve:: %s is off by up to %f with %d samples"), *Curve->GetName(), MaxError, BakedCurve.Samples.Num())
+	}
+
+	this->BakedCurveAssets.Add(Curve);
+	const int32 Index = this->BakedCurves.Add(MoveTemp(BakedCurve));
+
+	SET_MEMORY_STAT(STAT_ShooterBakedCurveMemory, this->GetBakedCurvesAllocatedSize());
+
+	return Index;
+}
+
+float UWeaponTimelineScheduler::SampleCurve(const UCurveFloat* Curve, float SampleRate, int32 MaxSamples, FBakedWeaponCurve& OutBakedCurve)
+{
+	float MinTime = 0.0f;
+	float MaxTime = 0.0f;
+	Curve->GetTimeRange(MinTime, MaxTime);
+
+	// At least two samples, so a flat or single key curve still interpolates
+	const int32 NumSamples = FMath::Clamp(FMath::CeilToInt((MaxTime - MinTime) * SampleRate) + 1, 2, FMath::Max(MaxSamples, 2));
+	const float SampleStep = (MaxTime - MinTime) / (NumSamples - 1);
+
+	OutBakedCurve.MinTime = MinTime;
+	OutBakedCurve.SampleRate = SampleStep > 0.0f ? 1.0f / SampleStep : 0.0f;
+	OutBakedCurve.Samples.SetNumUninitialized(NumSamples);
+
+	for (int32 Sample = 0; Sample < NumSamples; ++Sample)
+	{
+		OutBakedCurve.Samples[Sample] = Curve->GetFloatValue(MinTime + Sample * SampleStep);
+	}
+
+	// The table is furthest from the curve between samples, and around keys that fall between them
+	float MaxError = 0.0f;
+	for (int32 Sample = 0; Sample + 1 < NumSamples; ++Sample)
+	{
+		const float MidTime = MinTime + (Sample + 0.5f) * SampleStep;
+		MaxError = FMath::Max(MaxError, FMath::Abs(OutBakedCurve.Evaluate(MidTime) - Curve->GetFloatValue(MidTime)));
+	}
+
+	for (auto It = Curve->FloatCurve.GetKeyIterator(); It; ++It)
+	{
+		MaxError = FMath::Max(MaxError, FMath::Abs(OutBakedCurve.Evaluate(It->Time) - It->Value));
+	}
+
+	return MaxError;
+}
+
+SIZE_T UWeaponTimelineScheduler::GetBakedCurvesAllocatedSize() const
+{
+	SIZE_T AllocatedSize = this->BakedCurves.GetAllocatedSize() + this->BakedCurveAssets.GetAllocatedSize();
+	for (const FBakedWeaponCurve& BakedCurve : this->BakedCurves)
+	{
+		AllocatedSize += BakedCurve.Samples.GetAllocatedSize();
+	}
+
+	return AllocatedSize;
+}
+
+void UWeaponTimelineScheduler::Stop(AGameplayPlayerCharacter* Character, EWeaponTimelineType Type)
+{
+	const int32 Index = this->FindTimeline(Character, Type);
+	if (Index != INDEX_NONE)
+	{
+		this->ActiveTimelines.RemoveAtSwap(Index, 1, false);
+	}
+}
+
+bool UWeaponTimelineScheduler::IsPlaying(const AGameplayPlayerCharacter* Character, EWeaponTimelineType Type) const
+{
+	return this->FindTimeline(Character, Type) != INDEX_NONE;
+}
+
+int32 UWeaponTimelineScheduler::FindTimeline(const AGameplayPlayerCharacter* Character, EWeaponTimelineType Type) const
+{
+	for (int32 Index = 0; Index < this->ActiveTimelines.Num(); ++Index)
+	{
+		const FActiveWeaponTimeline& Timeline = this->ActiveTimelines[Index];
+		if (Timeline.Type == Type && Timeline.Character.Get() == Character)
+		{
+			return Index;
+		}
+	}
+
+	return INDEX_NONE;
+}
+
+void UWeaponTimelineScheduler::Tick(float DeltaTime)
+{
+	INC_DWORD_STAT_BY(STAT_ShooterTimelinesAdvanced, this->ActiveTimelines.Num());
+
+	this->PendingNotifications.Reset();
+
+	// Advance every playing timeline in one pass
+	for (int32 Index = 0; Index < this->ActiveTimelines.Num(); )
+	{
+		FActiveWeaponTimeline& Timeline = this->ActiveTimelines[Index];
+
+		AGameplayPlayerCharacter* Character = Timeline.Character.Get();
+		if (Character == nullptr)
+		{
+			// The character went away while animating
+			this->ActiveTimelines.RemoveAtSwap(Index, 1, false);
+			continue;
+		}
+
+		Timeline.Position = FMath::Min(Timeline.Position + DeltaTime, Timeline.Length);
+
+		if (Timeline.BakedCurve != INDEX_NONE)
+		{
+			Character->HandleWeaponTimelineUpdate(Timeline.Type, this->BakedCurves[Timeline.BakedCurve].Evaluate(Timeline.Position));
+		}
+
+		if (!Timeline.bEventFired && Timeline.EventTime >= 0.0f && Timeline.Position >= Timeline.EventTime)
+		{
+			Timeline.bEventFired = true;
+			this->PendingNotifications.Add({ Timeline.Character, Timeline.Type, false });
+		}
+
+		if (Timeline.Position >= Timeline.Length)
+		{
+			this->PendingNotifications.Add({ Timeline.Character, Timeline.Type, true });
+			this->ActiveTimelines.RemoveAtSwap(Index, 1, false);
+			continue;
+		}
+
+		++Index;
+	}
+
+	// Notifications may start or stop timelines, so they go out after the pass
+	for (const FPendingNotification& Notification : this->PendingNotifications)
+	{
+		AGameplayPlayerCharacter* Character = Notification.Character.Get();
+		if (Character == nullptr)
+		{
+			continue;
+		}
+
+		if (Notification.bFinished)
+		{
+			Character->HandleWeaponTimelineFinished(Notification.Type);
+		}
+		else
+		{
+			Character->HandleWeaponTimelineEvent(Notification.Type);
+		}
+	}
+
+	SET_MEMORY_STAT(STAT_ShooterTimelineMemory, this->ActiveTimelines.GetAllocatedSize() + this->PendingNotifications.GetAllocatedSize());
+}
+
+bool UWeaponTimelineScheduler::IsTickable() const
+{
+	return this->ActiveTimelines.Num() > 0 && Super::IsTickable();
+}
+
+TStatId UWeaponTimelineScheduler::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UWeaponTimelineScheduler, STATGROUP_ShooterTutorial);
+}
@@ -0,0 +1,101 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/Object.h"
+#include "Styling/SlateBrush.h"
+#include "Engine/StreamableManager.h"
+#include "BackpackIconAtlas.generated.h"
+
+class UCanvas;
+class UCanvasRenderTarget2D;
+class UTexture2D;
+
+/**
+ * Packs the backpack icons into one render target at load time, in a grid
+ * of equally sized cells as large as the largest icon. Every cell has a
+ * border of its icon's edge texels, and brush UVs are inset by half a
+ * texel, so filtering never reaches into a neighbouring icon. Widgets draw
+ * every icon from the same texture through brushes whose UV region selects
+ * the icon's cell, so the inventory
+ * binds one texture instead of one per icon and the source icons can be
+ * unloaded once the atlas is drawn. Only their paths are kept: if the
+ * render target has to be drawn again, the icons are loaded back for it.
+ */
+UCLASS(BlueprintType)
+class SHOOTERTUTORIAL_API UBackpackIconAtlas : public UObject
+{
+	GENERATED_BODY()
+
+public:
+
+	/* Draws the icons into a new atlas; the icon at index i lands in cell i. Cells are as large as the largest loaded icon, shrunk if the atlas would outgrow MaxAtlasSize */
+	void Build(UObject* WorldContextObject, const TArray<FStringAssetReference>& InIconPaths);
+
+	/* Gets a brush drawing the icon of the given cell, or an empty brush if there is no such cell */
+	UFUNCTION(BlueprintCallable, Category = "Backpack")
+	FSlateBrush MakeIconBrush(int32 CellIndex) const;
+
+	/* The texture all icons live in */
+	FORCEINLINE UCanvasRenderTarget2D* GetAtlasTexture() const
+	{
+		return AtlasTexture;
+	}
+
+	/* How many icons the atlas holds */
+	FORCEINLINE int32 GetNumIcons() const
+	{
+		return CellUVs.Num();
+	}
+
+private:
+
+	/* Draws every icon into its cell; called whenever the render target is updated */
+	UFUNCTION()
+	void DrawAtlas(UCanvas* Canvas, int32 Width, int32 Height);
+
+	/* Loads the icons a redraw found unloaded, then draws the atlas again */
+	void RequestMissingIcons(const TArray<FStringAssetReference>& MissingIconPaths);
+
+	/* Draws the atlas again once the missing icons are loaded */
+	void OnMissingIconsLoaded();
+
+public:
+
+	/* Largest width or height of the atlas, in pixels */
+	static const int32 MaxAtlasSize = 2048;
+
+	/* Cell size when none of the icons is loaded to measure, in pixels */
+	static const int32 DefaultCellSize = 128;
+
+	/* Border of repeated edge texels around every cell, in pixels */
+	static const int32 CellPadding = 2;
+
+private:
+
+	/* The atlas itself */
+	UPROPERTY(Transient)
+	UCanvasRenderTarget2D* AtlasTexture;
+
+	/* Every icon of the atlas, in cell order; only the paths, so the icons can be unloaded */
+	TArray<FStringAssetReference> IconPaths;
+
+	/* Whatever the atlas was built for, to reach the game instance's streamable manager */
+	TWeakObjectPtr<UObject> WorldContext;
+
+	/* Keeps the icons of a redraw loaded until they are drawn */
+	TSharedPtr<FStreamableHandle> MissingIconsHandle;
+
+	/* Cleared while drawing with freshly loaded icons, so icons that failed to load are not requested over and over */
+	bool bRequestMissingIcons = true;
+
+	/* UV rectangle of every cell */
+	TArray<FBox2D> CellUVs;
+
+	/* Size of the icon area of a cell, without its padding, in pixels */
+	int32 CellSize = DefaultCellSize;
+
+	/* How many cells a row of the atlas holds */
+	int32 NumColumns = 0;
+};
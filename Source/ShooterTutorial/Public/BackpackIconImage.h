@@ -0,0 +1,57 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/Image.h"
+#include "BackpackIconImage.generated.h"
+
+class AGameplayPlayerCharacter;
+
+/**
+ * Image showing the icon of one backpack item from the owning character's
+ * icon atlas. It takes the item's brush from GetBackpackIconBrush when it
+ * is built and again every time the atlas is rebuilt, so a menu only has
+ * to place it and set BackpackItemIndex.
+ */
+UCLASS()
+class SHOOTERTUTORIAL_API UBackpackIconImage : public UImage
+{
+	GENERATED_BODY()
+
+public:
+
+	/* The backpack item whose icon is shown */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Backpack")
+	int32 BackpackItemIndex = 0;
+
+	/* Shows the icon of another backpack item */
+	UFUNCTION(BlueprintCallable, Category = "Backpack")
+	void SetBackpackItemIndex(int32 NewBackpackItemIndex);
+
+	/* Takes the item's brush from the icon atlas again; the brush set in the designer stays until the atlas is built */
+	UFUNCTION(BlueprintCallable, Category = "Backpack")
+	void RefreshIcon();
+
+	/* UVisual interface */
+	virtual void ReleaseSlateResources(bool bReleaseChildren) override;
+
+protected:
+
+	/* UWidget interface */
+	virtual TSharedRef<SWidget> RebuildWidget() override;
+
+private:
+
+	/* Refreshes the icon once the owning character's atlas is built */
+	UFUNCTION()
+	void OnBackpackIconsLoaded();
+
+	/* The character of the player owning this widget, if it has one */
+	AGameplayPlayerCharacter* GetOwningCharacter() const;
+
+private:
+
+	/* The character whose atlas rebuilds this image listens to */
+	TWeakObjectPtr<AGameplayPlayerCharacter> BoundCharacter;
+};
@@ -0,0 +1,186 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "GameplayPlayerStructs.h"
+#include "BackpackInventoryComponent.generated.h"
+
+/* Native callback fired after an item changed, or with INDEX_NONE after the whole backpack did */
+DECLARE_MULTICAST_DELEGATE_OneParam(FBackpackItemsChangedDelegate, int32);
+
+/* An item of a backpack as sent to its owner: its references, its type and one byte for its selection and slot */
+USTRUCT()
+struct FReplicatedBackpackItem
+{
+	GENERATED_USTRUCT_BODY()
+
+	UPROPERTY()
+	TAssetSubclassOf<ABaseWeapon> WeaponToSpawnAsset;
+
+	UPROPERTY()
+	TAssetPtr<UTexture2D> BackpackImageAsset;
+
+	UPROPERTY()
+	EWeaponType WeaponType;
+
+	/* Slot in the low seven bits, selection in the high bit */
+	UPROPERTY()
+	uint8 State;
+
+	FReplicatedBackpackItem()
+		: WeaponType(EWeaponType::WT_Pistol)
+		, State(0)
+	{
+	}
+};
+
+/**
+ * Holds the items of a backpack together with indices that are updated on
+ * every change: a bit per selected item, the item in every slot and the
+ * items of every weapon type, plus the selected count. Selection and slot
+ * queries are O(1), type filters return a ready, index sorted list.
+ *
+ * The server owns the items. Adding or removing items is authority only,
+ * and the whole list replicates to the owner, in order, so indices mean
+ * the same item on both sides. Selection and slot take one byte per item,
+ * and an item that only changed its selection sends only that byte.
+ */
+UCLASS(ClassGroup = (Gameplay), meta = (BlueprintSpawnableComponent))
+class SHOOTERTUTORIAL_API UBackpackInventoryComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+
+	/* Sets default values for this component's properties */
+	UBackpackInventoryComponent();
+
+	/* Replication interface */
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
+	/* Replaces every item and rebuilds the indices */
+	UFUNCTION(BlueprintCallable, Category = "Backpack")
+	void SetItems(const TArray<FWeaponBackpackItem>& NewItems);
+
+	/* Adds an item at the end of the backpack and returns its index, or INDEX_NONE off the server */
+	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly, Category = "Backpack")
+	int32 AddItem(const FWeaponBackpackItem& Item);
+
+	/* Removes an item; the items after it move down one index, so this rebuilds the indices; server only */
+	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly, Category = "Backpack")
+	void RemoveItem(int32 ItemIndex);
+
+	/* Selects or deselects an item and puts it in a slot; an item already in that slot leaves it */
+	UFUNCTION(BlueprintCallable, Category = "Backpack")
+	bool SetItemSelected(int32 ItemIndex, bool bIsSelected, int32 Slot);
+
+	/* Gets the item in a slot, or INDEX_NONE if the slot is empty */
+	UFUNCTION(BlueprintCallable, Category = "Backpack")
+	int32 GetItemInSlot(int32 Slot) const;
+
+	/* Gets the indices of every selected item, in index order */
+	UFUNCTION(BlueprintCallable, Category = "Backpack")
+	void GetSelectedItems(TArray<int32>& OutItemIndices) const;
+
+	/* Gets the indices of every item of a weapon type, in index order */
+	UFUNCTION(BlueprintCallable, Category = "Backpack")
+	void GetItemsOfType(EWeaponType WeaponType, TArray<int32>& OutItemIndices) const;
+
+	/* Gets the indices of every item sorted by weapon type, then by index; the type index is already sorted, so this is linear */
+	UFUNCTION(BlueprintCallable, Category = "Backpack")
+	void GetItemsSortedByType(TArray<int32>& OutItemIndices) const;
+
+	/* Gets the indices of every slotted item sorted by slot */
+	UFUNCTION(BlueprintCallable, Category = "Backpack")
+	void GetItemsSortedBySlot(TArray<int32>& OutItemIndices) const;
+
+	/* Told about every change of the items, on every machine */
+	FBackpackItemsChangedDelegate OnItemsChangedDelegate;
+
+	/* The items of the backpack */
+	FORCEINLINE const TArray<FWeaponBackpackItem>& GetItems() const
+	{
+		return Items;
+	}
+
+	/* How many items the backpack holds */
+	FORCEINLINE int32 GetNumItems() const
+	{
+		return Items.Num();
+	}
+
+	/* Is this a valid item index ? */
+	FORCEINLINE bool IsValidItem(int32 ItemIndex) const
+	{
+		return Items.IsValidIndex(ItemIndex);
+	}
+
+	/* Gets an item, which must be valid */
+	FORCEINLINE const FWeaponBackpackItem& GetItem(int32 ItemIndex) const
+	{
+		return Items[ItemIndex];
+	}
+
+	/* How many items are selected */
+	FORCEINLINE int32 GetNumSelected() const
+	{
+		return NumSelected;
+	}
+
+	/* Is the item selected ? */
+	FORCEINLINE bool IsItemSelected(int32 ItemIndex) const
+	{
+		return SelectedItems.IsValidIndex(ItemIndex) && SelectedItems[ItemIndex];
+	}
+
+	/* Gets the indices of every item of a weapon type without copying them, or null if there are none */
+	FORCEINLINE const TArray<int32>* FindItemsOfType(EWeaponType WeaponType) const
+	{
+		return TypeToItems.Find((uint8)WeaponType);
+	}
+
+private:
+
+	/* Takes the server's items and rebuilds the indices */
+	UFUNCTION()
+	void OnRep_ReplicatedItems();
+
+	/* Copies an item into its replicated entry; server only */
+	void PackItem(int32 ItemIndex);
+
+	/* Packs the selection and slot of an item into its replicated entry's byte; server only */
+	void PackItemState(int32 ItemIndex);
+
+	/* Fills what an added item can work out by itself: soft references and weapon type */
+	void PrepareItem(FWeaponBackpackItem& Item) const;
+
+	/* Adds one item to every index */
+	void IndexItem(int32 ItemIndex);
+
+	/* Rebuilds every index from the items */
+	void RebuildIndices();
+
+private:
+
+	/* The items of the backpack */
+	UPROPERTY(VisibleAnywhere, Category = "Backpack")
+	TArray<FWeaponBackpackItem> Items;
+
+	/* One bit per item, set if the item is selected */
+	TBitArray<> SelectedItems;
+
+	/* How many bits of SelectedItems are set */
+	int32 NumSelected = 0;
+
+	/* The item in every occupied slot */
+	TMap<int32, int32> SlotToItem;
+
+	/* The items of every weapon type, in index order, keyed by EWeaponType */
+	TMap<uint8, TArray<int32>> TypeToItems;
+
+	/* The items as sent to the owner, in the same order, written on the server */
+	UPROPERTY(ReplicatedUsing = OnRep_ReplicatedItems)
+	TArray<FReplicatedBackpackItem> ReplicatedItems;
+};
@@ -0,0 +1,112 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "Components/SphereComponent.h"
+#include "GameFramework/ProjectileMovementComponent.h"
+#include "Sound/SoundBase.h"
+#include "Particles/ParticleSystem.h"
+#include "BaseProjectile.generated.h"
+
+/**
+ * A projectile fired by a weapon (grenades, rockets...). Projectiles are
+ * handed out by UProjectilePool and returned to it instead of being destroyed.
+ */
+UCLASS()
+class SHOOTERTUTORIAL_API ABaseProjectile : public AActor
+{
+	GENERATED_BODY()
+
+public:
+
+	/* The collision sphere that drives the projectile */
+	UPROPERTY(VisibleDefaultsOnly, BlueprintReadOnly, Category = "Projectile")
+	USphereComponent* CollisionComponent;
+
+	/* Moves the projectile while it is in flight */
+	UPROPERTY(VisibleDefaultsOnly, BlueprintReadOnly, Category = "Projectile")
+	UProjectileMovementComponent* ProjectileMovement;
+
+	/* How long the projectile can fly before it explodes on its own */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Projectile")
+	float MaxFlightTime = 3.0f;
+
+	/* Explode as soon as something stops the projectile instead of waiting for the flight time */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Projectile")
+	bool bExplodeOnStop = true;
+
+	/* Damage dealt at the center of the explosion */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Explosion")
+	float ExplosionDamage = 100.0f;
+
+	/* Radius of the explosion */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Explosion")
+	float ExplosionRadius = 300.0f;
+
+	/* Sound played every time the projectile bounces */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Effects")
+	USoundBase* BounceSound;
+
+	/* Sound played when the projectile explodes */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Effects")
+	USoundBase* ExplosionSound;
+
+	/* Particle effect spawned when the projectile explodes */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Effects")
+	UParticleSystem* ExplosionEffect;
+
+public:
+
+	/* Places the projectile and launches it along its forward vector, already CatchUpTime seconds into its flight */
+	void ActivateFromPool(const FTransform& LaunchTransform, AActor* NewOwner, APawn* NewInstigator, float CatchUpTime = 0.0f);
+
+	/* Stops, hides and resets the projectile so it can be handed out again */
+	void DeactivateToPool();
+
+	/* Is the projectile currently in flight ? */
+	FORCEINLINE bool IsActiveInWorld() const
+	{
+		return bIsActiveInWorld;
+	}
+
+	/* Explodes the projectile and gives it back to its pool */
+	UFUNCTION(BlueprintCallable, Category = "Projectile")
+	void Explode();
+
+public:
+
+	/* Sets default values for this actor's properties */
+	ABaseProjectile();
+
+protected:
+
+	/* Called when the game starts or when spawned */
+	virtual void BeginPlay() override;
+
+private:
+
+	/* Handles every bounce of the projectile movement */
+	UFUNCTION(Category = "Handlers")
+	void OnHandleProjectileBounce(const FHitResult& ImpactResult, const FVector& ImpactVelocity);
+
+	/* Handles the projectile movement coming to a stop */
+	UFUNCTION(Category = "Handlers")
+	void OnHandleProjectileStop(const FHitResult& ImpactResult);
+
+	/* Handles the end of the flight time */
+	UFUNCTION(Category = "Handlers")
+	void OnHandleFlightTimeOver();
+
+	/* Gives the projectile back to its pool, or destroys it if there is none */
+	void ReturnToPool();
+
+private:
+
+	/* Timer that ends the flight */
+	FTimerHandle FlightTimerHandle;
+
+	/* Is the projectile currently in flight ? */
+	bool bIsActiveInWorld;
+};
@@ -5,6 +5,8 @@
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
 #include "Runtime/Core/Public/GenericPlatform/GenericPlatformMath.h"
+#include "WeaponHitscanManager.h"
+#include "BaseProjectile.h"
 #include "BaseWeapon.generated.h"
 
 UENUM(BlueprintType)
@@ -15,6 +17,71 @@ enum class EWeaponType : uint8
 	WT_Shotgun	UMETA(DisplayName = "Shotgun")
 };
 
+/* Native callback fired on the frame after a hitscan shot has been traced */
+DECLARE_MULTICAST_DELEGATE_TwoParams(FWeaponHitscanResolvedDelegate, ABaseWeapon*, const FHitResult&);
+
+/* Native callback asked to fire one trigger shot at the given world time; returns false if it could not be fired */
+DECLARE_DELEGATE_RetVal_OneParam(bool, FWeaponTriggerShotDelegate, float);
+
+/* Native callback fired for every shot that actually leaves the weapon */
+DECLARE_DELEGATE_OneParam(FWeaponShotEmittedDelegate, ABaseWeapon*);
+
+/* Ammo counts of a weapon as sent over the network, each packed into as few bytes as its value needs */
+USTRUCT()
+struct FWeaponAmmoState
+{
+	GENERATED_USTRUCT_BODY()
+
+	UPROPERTY()
+	int32 AmmoInMag;
+
+	UPROPERTY()
+	int32 AmmoInBackpack;
+
+	FWeaponAmmoState()
+		: AmmoInMag(0)
+		, AmmoInBackpack(0)
+	{
+	}
+
+	bool operator==(const FWeaponAmmoState& Other) const
+	{
+		return AmmoInMag == Other.AmmoInMag && AmmoInBackpack == Other.AmmoInBackpack;
+	}
+
+	/* Counts below 128 take one byte each, so a typical update is two bytes */
+	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess)
+	{
+		uint32 PackedMag = FMath::Max(AmmoInMag, 0);
+		uint32 PackedBackpack = FMath::Max(AmmoInBackpack, 0);
+
+		Ar.SerializeIntPacked(PackedMag);
+		Ar.SerializeIntPacked(PackedBackpack);
+
+		if (Ar.IsLoading())
+		{
+			AmmoInMag = PackedMag;
+			AmmoInBackpack = PackedBackpack;
+		}
+
+		bOutSuccess = true;
+		return true;
+	}
+};
+
+template<>
+struct TStructOpsTypeTraits<FWeaponAmmoState> : public TStructOpsTypeTraitsBase2<FWeaponAmmoState>
+{
+	enum
+	{
+		WithNetSerializer = true,
+		WithIdenticalViaEquality = true,
+	};
+};
+
+struct FWeaponStats;
+class UWeaponCatalog;
+
 UCLASS()
 class SHOOTERTUTORIAL_API ABaseWeapon : public AActor
 {
@@ -28,11 +95,15 @@ public:
 	UPROPERTY(EditAnyWhere, BlueprintReadWrite, meta = (ExposeOnSpawn))
 	int32 IndexInBackpack;
 
+	/* Row of the weapon catalog this weapon reads its stats from */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Catalog")
+	FName WeaponId;
+
 	/* How much ammo do we have currently in the backpack */
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Ammunition")
 	int32 CurrentAmmoInMag;
 
-	/* How much ammo we can have in the magazine */
+	/* How much ammo we can have in the magazine; only used if WeaponId is not in the catalog */
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Ammunition")
 	int32 MaxAmmoInMag = 6;
 
@@ -40,26 +111,67 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Ammunition")
 	int32 CurrentAmmoInBackpack;
 
-	/* How much ammo we can have in the backpack */
+	/* How much ammo we can have in the backpack; only used if WeaponId is not in the catalog */
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Ammunition")
 	int32 MaxAmmoInBackpack = 30;
 
-	/* How much time is needed to reload the weapon */
+	/* How much time is needed to reload the weapon; only used if WeaponId is not in the catalog */
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Ammunition")
 	float ReloadTime = 2.0f;
 
-	/* The socket this weapon will be attached to in FPP mesh */
+	/* The socket this weapon will be attached to in FPP mesh; only used if WeaponId is not in the catalog */
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Socket")
 	FName AttachSocketNameFPP = FName(TEXT("WeaponPoint"));
 
-	/* The socket this weapon will be attached to in TPP mesh */
+	/* The socket this weapon will be attached to in TPP mesh; only used if WeaponId is not in the catalog */
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Socket")
 	FName AttachSocketNameTPP = FName(TEXT("WeaponPoint"));
 
-	/* The type of weapon this weapon is */
+	/* The type of weapon this weapon is; only used if WeaponId is not in the catalog */
 	UPROPERTY(EditAnywhere, BlueprintReadWrite)
 	EWeaponType WeaponType;
 
+	/* How far a hitscan shot of this weapon can reach */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Hitscan")
+	float HitscanRange = 10000.0f;
+
+	/* How many rays a single shot fires (more than one for shotguns) */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Hitscan", meta = (ClampMin = "1"))
+	int32 PelletsPerShot = 1;
+
+	/* Half angle of the cone, in degrees, in which the pellets are spread */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Hitscan", meta = (ClampMin = "0.0"))
+	float PelletSpreadAngle = 0.0f;
+
+	/* The collision channel hitscan shots are traced against */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Hitscan")
+	TEnumAsByte<ECollisionChannel> HitscanChannel = ECC_Visibility;
+
+	/* If set, shots launch pooled projectiles of this class instead of hitscan rays */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Projectile")
+	TSubclassOf<ABaseProjectile> ProjectileClass;
+
+	/* The socket of the weapon mesh projectiles are launched from */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Projectile")
+	FName MuzzleSocketName = FName(TEXT("Muzzle"));
+
+	/* Keeps firing while the trigger is held instead of once per trigger pull */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Fire")
+	bool bIsAutomatic = false;
+
+	/* How fast an automatic weapon fires while the trigger is held */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Fire", meta = (ClampMin = "1.0", EditCondition = "bIsAutomatic"))
+	float RoundsPerMinute = 600.0f;
+
+	/* Subscribers are told about every resolved hitscan shot of this weapon */
+	FWeaponHitscanResolvedDelegate OnHitscanResolvedDelegate;
+
+	/* Asked to fire every shot produced by the trigger; the holder binds its fire logic here */
+	FWeaponTriggerShotDelegate OnTriggerShotDelegate;
+
+	/* Told about every shot once it is fired, which with the state store can be a batch after Fire was called */
+	FWeaponShotEmittedDelegate OnShotEmittedDelegate;
+
 public:
 
 	/* Fires this weapon */
@@ -70,6 +182,10 @@ public:
 	UFUNCTION(BlueprintNativeEvent)
 	void Reload();
 
+	/* Native bodies of Fire and Reload, callable without going through the Blueprint thunk */
+	virtual void Fire_Implementation();
+	virtual void Reload_Implementation();
+
 	/* Do we have enough ammo in magazine ? */
 	UFUNCTION(BlueprintCallable)
 	void HaveAmmoInMag(bool& HaveAmmo, bool& MagIsFull);
@@ -78,6 +194,151 @@ public:
 	UFUNCTION(BlueprintCallable)
 	void HaveAmmoInBackpack(bool& HaveAmmo);
 
+	/* How much ammo we can have in the magazine */
+	UFUNCTION(BlueprintCallable, Category = "Catalog")
+	int32 GetMaxAmmoInMag() const;
+
+	/* How much ammo we can have in the backpack */
+	UFUNCTION(BlueprintCallable, Category = "Catalog")
+	int32 GetMaxAmmoInBackpack() const;
+
+	/* How much time is needed to reload the weapon */
+	UFUNCTION(BlueprintCallable, Category = "Catalog")
+	float GetReloadTime() const;
+
+	/* The socket this weapon will be attached to in FPP mesh */
+	UFUNCTION(BlueprintCallable, Category = "Catalog")
+	FName GetAttachSocketNameFPP() const;
+
+	/* The socket this weapon will be attached to in TPP mesh */
+	UFUNCTION(BlueprintCallable, Category = "Catalog")
+	FName GetAttachSocketNameTPP() const;
+
+	/* The type of weapon this weapon is */
+	UFUNCTION(BlueprintCallable, Category = "Catalog")
+	EWeaponType GetWeaponType() const;
+
+	/* Pulls the trigger: fires one shot now and, for automatic weapons, keeps firing until StopFiring */
+	UFUNCTION(BlueprintCallable, Category = "Fire")
+	void StartFiring();
+
+	/* Releases the trigger */
+	UFUNCTION(BlueprintCallable, Category = "Fire")
+	void StopFiring();
+
+	/* Is the trigger of this weapon held down ? */
+	FORCEINLINE bool IsTriggerHeld() const
+	{
+		return bTriggerHeld;
+	}
+
+	/* Seconds between two shots of an automatic weapon */
+	FORCEINLINE float GetFireInterval() const
+	{
+		return 60.0f / FMath::Max(RoundsPerMinute, 1.0f);
+	}
+
+	/* World time of the last shot the server took from the holder, checked against the fire interval; server only */
+	float LastAcceptedShotTime = -MAX_FLT;
+
+	/* Sets the world time the next call to Fire is stamped with, if it was fired between two frames */
+	FORCEINLINE void SetNextShotTimestamp(float Timestamp)
+	{
+		NextShotTimestamp = Timestamp;
+	}
+
+	/* The world time the next call to Fire will be stamped with, or negative if it happens now */
+	FORCEINLINE float GetNextShotTimestamp() const
+	{
+		return NextShotTimestamp;
+	}
+
+	/* Refills magazine and backpack, as for a freshly spawned weapon */
+	UFUNCTION(BlueprintCallable, Category = "Ammunition")
+	void ResetWeaponState();
+
+	/* Called by the hitscan manager once a shot of this weapon has been traced */
+	virtual void OnHitscanResolved(const FHitscanShot& Shot, const FHitResult& HitResult);
+
+	/* Sends one shot out of the weapon, as a projectile or as hitscan rays, stamped with the oldest pending Fire */
+	void EmitShot();
+
+	/* Forgets the timestamps of calls to Fire that will never be emitted */
+	FORCEINLINE void ClearPendingShotTimestamps()
+	{
+		PendingShotTimestamps.Reset();
+	}
+
+	/* Handle of this weapon in the weapon state store, or INDEX_NONE if it keeps its own state */
+	FORCEINLINE int32 GetStateStoreHandle() const
+	{
+		return StateStoreHandle;
+	}
+
+	/* Tells the network the ammo changed; the holder, which replicates its weapons' ammo, is sent on the next net tick */
+	void MarkAmmoDirty();
+
+	/* Puts the weapon away or takes it out. A holstered weapon is hidden, detached, does not tick or pose its mesh
+	 * and, on the server, is net dormant; taking it out only wakes it, the holder attaches it where it wants it */
+	UFUNCTION(BlueprintCallable, Category = "Holster")
+	void SetHolstered(bool bNewHolstered);
+
+	/* Is this weapon put away ? */
+	FORCEINLINE bool IsHolstered() const
+	{
+		return bIsHolstered;
+	}
+
+protected:
+
+	/* Queues the hitscan rays of one shot, aimed from the owner's point of view */
+	void QueueHitscanShot(float Timestamp);
+
+	/* Launches one pooled projectile from the muzzle, aimed from the owner's point of view, as if fired at Timestamp */
+	void LaunchProjectile(float Timestamp);
+
+	/* Gets where the owner of this weapon is looking from and at */
+	void GetAimViewPoint(FVector& ViewLocation, FRotator& ViewRotation) const;
+
+	/* Gets this weapon's row of the weapon catalog, or nullptr if it has none */
+	const FWeaponStats* GetCatalogStats() const;
+
+	/* Looks WeaponId up in the weapon catalog */
+	void ResolveCatalogIndex();
+
+	/* Fires one shot of the trigger at the given world time, through OnTriggerShotDelegate if bound */
+	bool FireTriggerShot(float ShotTime);
+
+private:
+
+	/* The catalog WeaponId was resolved against */
+	UPROPERTY(Transient)
+	UWeaponCatalog* WeaponCatalog;
+
+	/* Index of WeaponId in the weapon catalog, or INDEX_NONE; looked up again when the catalog is rebaked */
+	mutable int32 CatalogIndex = INDEX_NONE;
+
+	/* Bake version of the catalog CatalogIndex was resolved against */
+	mutable uint32 CatalogBakeVersion = 0;
+
+	/* Handle of this weapon in the weapon state store, or INDEX_NONE */
+	int32 StateStoreHandle = INDEX_NONE;
+
+	/* Is the trigger held down ? */
+	bool bTriggerHeld = false;
+
+	/* Time the trigger has been held since the last automatic shot */
+	float FireAccumulator = 0.0f;
+
+	/* World time of the next call to Fire, or negative to use the current time */
+	float NextShotTimestamp = -1.0f;
+
+	/* World time of every call to Fire not emitted yet, oldest first; a store batch can emit several in one frame */
+	TArray<float, TInlineAllocator<4>> PendingShotTimestamps;
+
+	/* Is this weapon put away ? */
+	bool bIsHolstered = false;
+
 public:
 
 	/* Sets default values for this actor's properties */
@@ -88,6 +349,9 @@ protected:
 	/* Called when the game starts or when spawned */
 	virtual void BeginPlay() override;
 
+	/* Called when the weapon is removed from the world */
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
 public:	
 
 	/* Called every frame */
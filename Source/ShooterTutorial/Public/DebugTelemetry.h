@@ -0,0 +1,79 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/* Debug telemetry only exists in builds that can show it */
+#define SHOOTER_DEBUG_TELEMETRY !(UE_BUILD_SHIPPING || UE_BUILD_TEST)
+
+/* The values the telemetry channel can record */
+namespace EDebugTelemetryChannel
+{
+	enum Type : uint8
+	{
+		MouseX,
+		MouseY,
+
+		Num
+	};
+}
+
+#if SHOOTER_DEBUG_TELEMETRY
+
+class UCanvas;
+
+/* One recorded value */
+struct FDebugTelemetrySample
+{
+	/* Real time at which the value was recorded */
+	float Time;
+
+	/* The recorded value */
+	float Value;
+
+	/* Which EDebugTelemetryChannel the value belongs to */
+	EDebugTelemetryChannel::Type Channel;
+};
+
+/**
+ * Game thread ring buffer of numeric debug samples. Recording a sample
+ * never allocates and never formats; the text is only built by Draw while
+ * the overlay is shown. Enabled with Shooter.DebugTelemetry 1 and compiled
+ * out of Test and Shipping builds, use SHOOTER_RECORD_TELEMETRY to record.
+ */
+class SHOOTERTUTORIAL_API FDebugTelemetry
+{
+public:
+
+	/* How many samples are kept; older samples are overwritten */
+	static const int32 Capacity = 256;
+
+	/* Is the telemetry channel recording ? */
+	static bool IsEnabled();
+
+	/* Records one sample if the channel is enabled */
+	static void Record(EDebugTelemetryChannel::Type Channel, float Value);
+
+	/* Draws the latest sample of every channel and a short history, if the channel is enabled */
+	static void Draw(UCanvas* Canvas, float X, float Y);
+
+private:
+
+	/* The ring buffer itself */
+	static FDebugTelemetrySample Samples[Capacity];
+
+	/* Where the next sample goes */
+	static int32 Head;
+
+	/* How many samples were recorded, capped at Capacity */
+	static int32 NumSamples;
+};
+
+#define SHOOTER_RECORD_TELEMETRY(Channel, Value) FDebugTelemetry::Record(EDebugTelemetryChannel::Channel, (Value))
+
+#else
+
+#define SHOOTER_RECORD_TELEMETRY(Channel, Value)
+
+#endif
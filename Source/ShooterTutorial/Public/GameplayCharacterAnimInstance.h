@@ -0,0 +1,199 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Animation/AnimInstance.h"
+#include "Animation/AnimInstanceProxy.h"
+#include "GameplayCharacterAnimInstance.generated.h"
+
+class UGameplayCharacterAnimInstance;
+
+/* What the anim graph of a character reads, worked out on a worker thread every frame */
+USTRUCT(BlueprintType)
+struct FGameplayCharacterAnimValues
+{
+	GENERATED_USTRUCT_BODY()
+
+	/* Ground speed, in units per second */
+	UPROPERTY(BlueprintReadOnly, Category = "Locomotion")
+	float Speed;
+
+	/* Angle between where the character faces and where it moves, in degrees from -180 to 180 */
+	UPROPERTY(BlueprintReadOnly, Category = "Locomotion")
+	float Direction;
+
+	/* Is the character moving on the ground fast enough to run ? */
+	UPROPERTY(BlueprintReadOnly, Category = "Locomotion")
+	bool bIsRunning;
+
+	/* Is the character jumping or falling ? */
+	UPROPERTY(BlueprintReadOnly, Category = "Locomotion")
+	bool bIsInAir;
+
+	/* Pitch of the aim relative to the character, in degrees */
+	UPROPERTY(BlueprintReadOnly, Category = "Aim")
+	float AimPitch;
+
+	/* Yaw of the aim relative to the character, in degrees */
+	UPROPERTY(BlueprintReadOnly, Category = "Aim")
+	float AimYaw;
+
+	/* Blend weights of the AimOffsetUp, AimOffsetDown, AimOffsetLeft and AimOffsetRight poses */
+	UPROPERTY(BlueprintReadOnly, Category = "Aim")
+	float AimOffsetUpWeight;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Aim")
+	float AimOffsetDownWeight;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Aim")
+	float AimOffsetLeftWeight;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Aim")
+	float AimOffsetRightWeight;
+
+	/* How far the weapon is put down, from 0 for up to 1 for down */
+	UPROPERTY(BlueprintReadOnly, Category = "Weapon")
+	float WeaponPullDownPercent;
+
+	/* Offset of the hands and weapon for WeaponPullDownPercent, in mesh space */
+	UPROPERTY(BlueprintReadOnly, Category = "Weapon")
+	FVector HandsOffset;
+
+	/* Is the character reloading ? */
+	UPROPERTY(BlueprintReadOnly, Category = "Weapon")
+	bool bIsReloading;
+
+	/* Is the character changing weapon ? */
+	UPROPERTY(BlueprintReadOnly, Category = "Weapon")
+	bool bIsChangingWeapon;
+
+	FGameplayCharacterAnimValues()
+		: Speed(0.0f)
+		, Direction(0.0f)
+		, bIsRunning(false)
+		, bIsInAir(false)
+		, AimPitch(0.0f)
+		, AimYaw(0.0f)
+		, AimOffsetUpWeight(0.0f)
+		, AimOffsetDownWeight(0.0f)
+		, AimOffsetLeftWeight(0.0f)
+		, AimOffsetRightWeight(0.0f)
+		, WeaponPullDownPercent(0.0f)
+		, HandsOffset(ForceInitToZero)
+		, bIsReloading(false)
+		, bIsChangingWeapon(false)
+	{
+	}
+};
+
+/**
+ * Anim instance proxy of UGameplayCharacterAnimInstance. PreUpdate copies
+ * the character state it needs on the game thread, Update turns it into
+ * the graph's values on whatever thread updates the animation and keeps
+ * them here. PostUpdate hands them to the instance back on the game thread,
+ * so the worker thread never writes to the instance.
+ */
+USTRUCT()
+struct FGameplayCharacterAnimInstanceProxy : public FAnimInstanceProxy
+{
+	GENERATED_USTRUCT_BODY()
+
+public:
+
+	FGameplayCharacterAnimInstanceProxy()
+		: Instance(nullptr)
+	{
+	}
+
+	FGameplayCharacterAnimInstanceProxy(UAnimInstance* InAnimInstance);
+
+	/* FAnimInstanceProxy interface */
+	virtual void Initialize(UAnimInstance* InAnimInstance) override;
+	virtual void PreUpdate(UAnimInstance* InAnimInstance, float DeltaSeconds) override;
+	virtual void Update(float DeltaSeconds) override;
+	virtual void PostUpdate(UAnimInstance* InAnimInstance) const override;
+
+	/* Values of the current update; only the updating thread writes them */
+	FORCEINLINE const FGameplayCharacterAnimValues& GetAnimValues() const
+	{
+		return AnimValues;
+	}
+
+private:
+
+	/* The instance the settings are copied from, on the game thread only */
+	UGameplayCharacterAnimInstance* Instance;
+
+	/* Values for the graph, computed by Update */
+	FGameplayCharacterAnimValues AnimValues;
+
+	/* Character state, copied once per frame */
+	FVector Velocity;
+	FRotator ActorRotation;
+	FRotator AimRotation;
+	float WeaponPullDownPercent;
+	bool bIsFalling;
+	bool bIsReloading;
+	bool bIsChangingWeapon;
+
+	/* Settings of the instance, copied with the state so Update never reads the instance */
+	float RunSpeedThreshold;
+	float MaxAimPitch;
+	float MaxAimYaw;
+	FVector WeaponDownOffset;
+};
+
+/**
+ * Native parent of the FPP and TPP anim blueprints of AGameplayPlayerCharacter.
+ * Only a copy of the character state is taken on the game thread; speed,
+ * direction, aim offset weights and the pulled down hands offset are
+ * computed by the proxy alongside the graph, off the game thread when
+ * multi-threaded animation update is on. AnimValues is the copy of the
+ * previous update taken on the game thread; GetAnimValues reads the
+ * proxy's values of the update running now.
+ */
+UCLASS(Transient, Blueprintable)
+class SHOOTERTUTORIAL_API UGameplayCharacterAnimInstance : public UAnimInstance
+{
+	GENERATED_BODY()
+
+	friend struct FGameplayCharacterAnimInstanceProxy;
+
+public:
+
+	/* Values of the last finished update, copied from the proxy on the game thread */
+	UPROPERTY(BlueprintReadOnly, Category = "Animation")
+	FGameplayCharacterAnimValues AnimValues;
+
+	/* Values of the current update, safe to call from the anim graph on any thread */
+	UFUNCTION(BlueprintPure, Category = "Animation")
+	FGameplayCharacterAnimValues GetAnimValues() const;
+
+	/* Is this the anim instance of the character's FPP mesh ? */
+	UPROPERTY(BlueprintReadOnly, Category = "Animation")
+	bool bIsFirstPersonMesh = false;
+
+	/* Ground speed above which the character runs */
+	UPROPERTY(EditDefaultsOnly, Category = "Locomotion")
+	float RunSpeedThreshold = 10.0f;
+
+	/* Aim pitch at which AimOffsetUp and AimOffsetDown are fully blended in, in degrees */
+	UPROPERTY(EditDefaultsOnly, Category = "Aim", meta = (ClampMin = "1.0"))
+	float MaxAimPitch = 90.0f;
+
+	/* Aim yaw at which AimOffsetLeft and AimOffsetRight are fully blended in, in degrees */
+	UPROPERTY(EditDefaultsOnly, Category = "Aim", meta = (ClampMin = "1.0"))
+	float MaxAimYaw = 90.0f;
+
+	/* Hands offset when the weapon is all the way down, in mesh space */
+	UPROPERTY(EditDefaultsOnly, Category = "Weapon")
+	FVector WeaponDownOffset = FVector(0.0f, 0.0f, -40.0f);
+
+protected:
+
+	/* UAnimInstance interface */
+	virtual void NativeInitializeAnimation() override;
+	virtual FAnimInstanceProxy* CreateAnimInstanceProxy() override;
+	virtual void DestroyAnimInstanceProxy(FAnimInstanceProxy* InProxy) override;
+};
@@ -7,6 +7,7 @@
 #include "GameplayGameState.h"
 #include "GameplayPlayerController.h"
 #include "GameplayHUD.h"
+#include "ShooterSoakDriver.h"
 #include "GameplayGameMode.generated.h"
 
 /**
@@ -21,5 +22,24 @@ public:
 
 	// Sets default values for this gamemode's properties
 	AGameplayGameMode();
+
+	// The soak driver spawned when the game runs with -ShooterSoak
+	UPROPERTY(EditDefaultsOnly, Category = "Soak")
+	TSubclassOf<AShooterSoakDriver> SoakDriverClass;
+
+	// Called when the match starts
+	virtual void StartPlay() override;
+
+	// Logs the bandwidth of every connected player; repeats every RepeatSeconds if positive, a zero stops it
+	UFUNCTION(Exec)
+	void ShooterNetStats(float RepeatSeconds);
+
+private:
+
+	// Logs one line per client connection
+	void LogNetStats();
+
+	// Repeats LogNetStats while ShooterNetStats is running
+	FTimerHandle NetStatsTimerHandle;
 	
 };
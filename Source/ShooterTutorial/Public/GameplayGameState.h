@@ -4,14 +4,101 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/GameStateBase.h"
+#include "WeaponHitscanManager.h"
+#include "ProjectilePool.h"
+#include "WeaponPool.h"
+#include "WeaponTimelineScheduler.h"
+#include "WeaponStateStore.h"
+#include "LagCompensationManager.h"
 #include "GameplayGameState.generated.h"
 
 
 /**
- * 
+ * Game state of the gameplay mode. Besides the usual match state it owns the
+ * per world gameplay managers shared by every character and weapon.
  */
 UCLASS()
 class SHOOTERTUTORIAL_API AGameplayGameState : public AGameStateBase
 {
 	GENERATED_BODY()
+
+public:
+
+	/* How many projectiles of each class are spawned up front when the match starts */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Pools")
+	TMap<TSubclassOf<ABaseProjectile>, int32> ProjectilePoolSizes;
+
+public:
+
+	/* Gets the manager that batches every hitscan shot of the frame */
+	FORCEINLINE UWeaponHitscanManager* GetHitscanManager() const
+	{
+		return HitscanManager;
+	}
+
+	/* Gets the pool that hands out projectiles */
+	FORCEINLINE UProjectilePool* GetProjectilePool() const
+	{
+		return ProjectilePool;
+	}
+
+	/* Gets the pool that hands out weapons */
+	FORCEINLINE UWeaponPool* GetWeaponPool() const
+	{
+		return WeaponPool;
+	}
+
+	/* Gets the scheduler that plays every character's weapon timelines */
+	FORCEINLINE UWeaponTimelineScheduler* GetWeaponTimelineScheduler() const
+	{
+		return WeaponTimelineScheduler;
+	}
+
+	/* Gets the optional data oriented store of weapon state */
+	FORCEINLINE UWeaponStateStore* GetWeaponStateStore() const
+	{
+		return WeaponStateStore;
+	}
+
+	/* Gets the server side history of every character, for rewinding shots */
+	FORCEINLINE ULagCompensationManager* GetLagCompensationManager() const
+	{
+		return LagCompensationManager;
+	}
+
+public:
+
+	/* Called after all components have been initialized */
+	virtual void PostInitializeComponents() override;
+
+protected:
+
+	/* Called when the game starts or when spawned */
+	virtual void BeginPlay() override;
+
+private:
+
+	/* Batches and resolves hitscan shots for the whole world */
+	UPROPERTY(Transient)
+	UWeaponHitscanManager* HitscanManager;
+
+	/* Pools projectiles for the whole world */
+	UPROPERTY(Transient)
+	UProjectilePool* ProjectilePool;
+
+	/* Pools weapons for the whole world */
+	UPROPERTY(Transient)
+	UWeaponPool* WeaponPool;
+
+	/* Plays weapon timelines for the whole world */
+	UPROPERTY(Transient)
+	UWeaponTimelineScheduler* WeaponTimelineScheduler;
+
+	/* Holds weapon state of store backed weapons and headless agents */
+	UPROPERTY(Transient)
+	UWeaponStateStore* WeaponStateStore;
+
+	/* Records and rewinds characters for the whole world */
+	UPROPERTY(Transient)
+	ULagCompensationManager* LagCompensationManager;
 };
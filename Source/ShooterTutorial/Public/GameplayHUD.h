@@ -7,14 +7,15 @@
 #include "GameplayHUD.generated.h"
 
 /**
- * 
+ * The in game HUD; draws the debug telemetry overlay in development builds
  */
 UCLASS()
 class SHOOTERTUTORIAL_API AGameplayHUD : public AHUD
 {
 	GENERATED_BODY()
-	
-	
-	
-	
+
+public:
+
+	/* Called every frame to draw the HUD */
+	virtual void DrawHUD() override;
 };
@@ -0,0 +1,33 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/Interface.h"
+#include "GameplayMenuInterface.generated.h"
+
+UINTERFACE(BlueprintType)
+class UGameplayMenuInterface : public UInterface
+{
+	GENERATED_BODY()
+};
+
+/**
+ * Implemented by the menus AGameplayPlayerController keeps cached in the
+ * viewport. A cached menu is only collapsed and made visible again, so its
+ * Construct runs once; these events are where it reads fresh data instead.
+ */
+class SHOOTERTUTORIAL_API IGameplayMenuInterface
+{
+	GENERATED_BODY()
+
+public:
+
+	/* Called every time the menu is made visible, before it is drawn */
+	UFUNCTION(BlueprintImplementableEvent, Category = "Widgets")
+	void OnMenuShown();
+
+	/* Called every time the menu is collapsed */
+	UFUNCTION(BlueprintImplementableEvent, Category = "Widgets")
+	void OnMenuHidden();
+};
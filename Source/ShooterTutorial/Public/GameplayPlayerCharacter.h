@@ -9,13 +9,20 @@
 #include "Runtime/Core/Public/Math/UnrealMathUtility.h"
 #include "Runtime/Engine/Classes/Camera/CameraComponent.h"
 #include "Runtime/Engine/Public/TimerManager.h"
-#include "Runtime/Engine/Classes/Components/TimelineComponent.h" 
+#include "Runtime/Engine/Classes/Curves/CurveFloat.h"
+#include "WeaponTimelineScheduler.h"
+#include "WeaponActionStateMachine.h"
 #include "Engine/GameInstance.h"
 #include "BaseWeapon.h"
+#include "BackpackIconAtlas.h"
+#include "BackpackInventoryComponent.h"
 #include "GameFramework/Character.h"
 #include "GameplayPlayerCharacter.generated.h"
 
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FCharacterFireDelegate, EWeaponType, WeaponType);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE(FCharacterBackpackIconsLoadedDelegate);
+
+struct FStreamableHandle;
 
 UCLASS()
 class AGameplayPlayerCharacter : public ACharacter
@@ -27,41 +34,61 @@ protected:
 	/* Called when the game starts or when spawned */
 	virtual void BeginPlay() override;
 
+	/* Called when the character is removed from the world */
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
 public:
 
-	/* The backpack in which to store player's weapons */
+	/* Fills the backpack inventory with the starting backpack */
+	virtual void PostInitializeComponents() override;
+
+	/* Fills the soft references of backpacks authored with hard ones only */
+	virtual void PostLoad() override;
+
+	/* Replication interface */
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+	virtual void PreReplication(IRepChangedPropertyTracker& ChangedPropertyTracker) override;
+
+	/* The starting backpack, copied into BackpackInventory once components are initialized; from then on a copy of the inventory kept for widgets */
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "PlayerWeapons")
 	TArray<FWeaponBackpackItem> BackpackWeapons;
 
+	/* The backpack in play, with indexed selection, slot and type queries */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "PlayerWeapons")
+	UBackpackInventoryComponent* BackpackInventory;
+
 	/* The current player's weapon */
-	UPROPERTY(BlueprintReadOnly, Category = "PlayerWeapons")
+	UPROPERTY(ReplicatedUsing = OnRep_CurrentWeapon, BlueprintReadOnly, Category = "PlayerWeapons")
 	ABaseWeapon* CurrentWeapon;
 
 	/* The current player's first slot available for a weapon */
-	UPROPERTY(BlueprintReadOnly, Category = "PlayerWeapons")
+	UPROPERTY(ReplicatedUsing = OnRep_WeaponSlots, BlueprintReadOnly, Category = "PlayerWeapons")
 	ABaseWeapon* WeaponSlot1;
 
 	/* The current player's second slot available for a weapon */
-	UPROPERTY(BlueprintReadOnly, Category = "PlayerWeapons")
+	UPROPERTY(ReplicatedUsing = OnRep_WeaponSlots, BlueprintReadOnly, Category = "PlayerWeapons")
 	ABaseWeapon* WeaponSlot2;
 
 	/* The current player's third slot available for a weapon */
-	UPROPERTY(BlueprintReadOnly, Category = "PlayerWeapons")
+	UPROPERTY(ReplicatedUsing = OnRep_WeaponSlots, BlueprintReadOnly, Category = "PlayerWeapons")
 	ABaseWeapon* WeaponSlot3;
 
-	/* Checks if this character can fire or not */
-	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "PlayerWeapons")
+	/* Checks if this character can fire or not; mirrors the weapon action state */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "PlayerWeapons")
 	bool bCanFire;
 
-	/* Tell us if hands are doing reloading animation */
-	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "PlayerWeapons")
+	/* Tell us if hands are doing reloading animation; mirrors the weapon action state */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "PlayerWeapons")
 	bool bIsReloading;
 
-	/* Tell us if we are currently changing our weapon */
-	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "PlayerWeapons")
+	/* Tell us if we are currently changing our weapon; mirrors the weapon action state */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "PlayerWeapons")
 	bool bIsChangingWeapon;
 
+	/* How long a fire, reload or equip pressed during a reload or equip waits to run once it ends, in seconds */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "PlayerWeapons", meta = (ClampMin = "0.0"))
+	float WeaponInputBufferTime = 0.2f;
+
 	/* This will be used for put weapon down and up as a changing weapon animation */
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "PlayerWeapons")
 	float WeaponPullDownPercent = 0.0f;
@@ -78,6 +105,14 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "PlayerItems")
 	USkeletalMeshComponent* FPPMesh;
 
+	/* Anim class of FPPMesh, applied when the character is spawned; leave empty to keep the mesh's own */
+	UPROPERTY(EditDefaultsOnly, Category = "Animation")
+	TSubclassOf<class UGameplayCharacterAnimInstance> FPPAnimClass;
+
+	/* Anim class of the TPP mesh, applied when the character is spawned; leave empty to keep the mesh's own */
+	UPROPERTY(EditDefaultsOnly, Category = "Animation")
+	TSubclassOf<class UGameplayCharacterAnimInstance> TPPAnimClass;
+
 	/* Curve float reference for WeaponReloadDown */
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Timeline")
 	UCurveFloat* WeaponReloadDownCurve;
@@ -93,6 +128,14 @@ public:
 	UPROPERTY(BlueprintAssignable, Category = "Delegates")
 	FCharacterFireDelegate OnCharacterFireDelegate;
 
+	/* Called once the backpack icon atlas requested with RequestBackpackIcons is ready */
+	UPROPERTY(BlueprintAssignable, Category = "Delegates")
+	FCharacterBackpackIconsLoadedDelegate OnBackpackIconsLoadedDelegate;
+
+	/* Every backpack icon packed into one texture, built by RequestBackpackIcons */
+	UPROPERTY(Transient, BlueprintReadOnly, Category = "PlayerWeapons")
+	UBackpackIconAtlas* BackpackIconAtlas;
+
 public:
 
 	/* Gets current shooter game instance */
@@ -123,25 +166,73 @@ public:
 	UFUNCTION(BlueprintNativeEvent, Category = "PlayerWeapons")
 	void FireWeapon();
 
+	/* Pulls the trigger of the equipped weapon; automatic weapons keep firing until StopFireWeapon */
+	UFUNCTION(BlueprintCallable, Category = "PlayerWeapons")
+	void StartFireWeapon();
+
+	/* Releases the trigger of the equipped weapon */
+	UFUNCTION(BlueprintCallable, Category = "PlayerWeapons")
+	void StopFireWeapon();
+
 	/* Spawns the weapons and assign them to available slots */
 	UFUNCTION(BlueprintCallable, Category = "PlayerWeapons")
 	void SpawnWeaponsAndAssignToSlots();
 
+	/* Starts loading the weapon classes of every slotted backpack item, ahead of SpawnWeaponsAndAssignToSlots */
+	UFUNCTION(BlueprintCallable, Category = "PlayerWeapons")
+	void PrefetchSlottedWeapons();
+
+	/* Makes sure the icon atlas holds every backpack icon; OnBackpackIconsLoadedDelegate fires once it does */
+	UFUNCTION(BlueprintCallable, Category = "PlayerWeapons")
+	void RequestBackpackIcons();
+
+	/* Lets the backpack icons be unloaded again, once the selection UI is closed */
+	UFUNCTION(BlueprintCallable, Category = "PlayerWeapons")
+	void ReleaseBackpackIcons();
+
+	/* Gets the icon of a backpack item, or null while it is not loaded; the UI should draw GetBackpackIconBrush instead */
+	UFUNCTION(BlueprintCallable, Category = "PlayerWeapons")
+	UTexture2D* GetBackpackIcon(int32 BackpackItemIndex) const;
+
+	/* Gets a brush drawing the icon of a backpack item from the icon atlas, as UBackpackIconImage does */
+	UFUNCTION(BlueprintCallable, Category = "PlayerWeapons")
+	FSlateBrush GetBackpackIconBrush(int32 BackpackItemIndex) const;
+
+	/* Gives the slot weapons back to the weapon pool and empties the slots */
+	UFUNCTION(BlueprintCallable, Category = "PlayerWeapons")
+	void ReleaseSlotWeapons();
+
 	/* This is a helper function to hide and show weapons in slots */
 	UFUNCTION(BlueprintCallable, Category = "PlayerWeapons")
 	void ShowCurrentWeapon(const ABaseWeapon* WeaponToShow);
 
+	/* Is the weapon in one of our slots ? Only the owner and the server know the slots */
+	FORCEINLINE bool IsSlotWeapon(const ABaseWeapon* Weapon) const
+	{
+		return Weapon && (Weapon == WeaponSlot1 || Weapon == WeaponSlot2 || Weapon == WeaponSlot3);
+	}
+
+	/* What the weapon is busy with */
+	UFUNCTION(BlueprintCallable, Category = "PlayerWeapons")
+	EWeaponActionState GetWeaponActionState() const;
+
 public:
 
 	/* Sets default values for this character's properties */
 	AGameplayPlayerCharacter();
 
-	/* Called every frame */
-	virtual void Tick(float DeltaTime) override;
-
 	/* Called to bind functionality to input */
 	virtual void SetupPlayerInputComponent(class UInputComponent* PlayerInputComponent) override;
 
+	/* Called by the weapon timeline scheduler every frame one of our timelines plays */
+	void HandleWeaponTimelineUpdate(EWeaponTimelineType Type, float Value);
+
+	/* Called by the weapon timeline scheduler when the event of one of our timelines is reached */
+	void HandleWeaponTimelineEvent(EWeaponTimelineType Type);
+
+	/* Called by the weapon timeline scheduler when one of our timelines ends */
+	void HandleWeaponTimelineFinished(EWeaponTimelineType Type);
+
 private:
 
 	/* The function that will handle every tick of the float curve */
@@ -186,15 +277,146 @@ private:
 
 private:
 
-	/* The timeline for equipping a weapon */
-	FTimeline EquipWeaponTimeline;
+	/* Fires one shot the owning client predicted, if the server agrees it can be fired; ServerTime is when the client saw it happen */
+	UFUNCTION(Server, Reliable, WithValidation)
+	void ServerFireWeapon(uint16 Sequence, float ServerTime);
+
+	/* Runs a reload the owning client predicted; acknowledged once the magazine is refilled */
+	UFUNCTION(Server, Reliable, WithValidation)
+	void ServerReloadWeapon(uint16 Sequence);
+
+	/* Runs an equip the owning client predicted; acknowledged once the weapons are swapped */
+	UFUNCTION(Server, Reliable, WithValidation)
+	void ServerEquipWeapon(ABaseWeapon* Weapon, uint16 Sequence);
+
+	/* Runs SetBackpackItemSelected on the server */
+	UFUNCTION(Server, Reliable, WithValidation)
+	void ServerSetBackpackItemSelected(int32 BackPackItemIndex, bool bIsSelected, int32 WhichSlot);
 
-	/* The timeline for reloading up a weapon */
-	FTimeline WeaponReloadUpTimeline;
+	/* Runs SpawnWeaponsAndAssignToSlots on the server */
+	UFUNCTION(Server, Reliable, WithValidation)
+	void ServerSpawnWeaponsAndAssignToSlots();
 
-	/* The timeline for realoading down a weapon */
-	FTimeline WeaponReloadDownTimeline;
+	/* Shows the weapon the server equipped and moves the trigger binding over to it, unless a newer equip of ours is on its way */
+	UFUNCTION()
+	void OnRep_CurrentWeapon(ABaseWeapon* PreviousWeapon);
 
-	/* The new weapon to equip on EquipWeapon event */
+	/* Makes CurrentWeapon, as received from the server, the weapon in hand */
+	void ApplyReplicatedCurrentWeapon(ABaseWeapon* PreviousWeapon);
+
+	/* Is an action of this type still waiting for the server ? */
+	bool HasPendingWeaponAction(EWeaponActionType Type) const;
+
+	/* Attaches the weapons the server slotted; attachment itself is not replicated */
+	UFUNCTION()
+	void OnRep_WeaponSlots();
+
+	/* Unpacks the reload and equip state and plays the fire effects of the shots fired since the last update */
+	UFUNCTION()
+	void OnRep_WeaponState();
+
+	/* Drops the actions the server processed and replays the rest over its ammo */
+	UFUNCTION()
+	void OnRep_WeaponActionAck();
+
+	/* Remembers an action applied ahead of the server and returns the sequence to send it with */
+	uint16 RecordWeaponAction(EWeaponActionType Type, ABaseWeapon* Weapon);
+
+	/* Marks an action as processed, so the next acknowledgement covers it; server only */
+	void AcknowledgeWeaponAction(uint16 Sequence);
+
+	/* Fires the pending server shot at its client time if the weapon allows it, then acknowledges it; server only */
+	void ExecutePendingServerFire();
+
+	/* Pulls the trigger of the current weapon once; the weapon or its store agent decides if a round leaves */
+	void FireCurrentWeaponShot();
+
+	/* Counts a shot of the current weapon for other clients and tells the fire subscribers */
+	void HandleWeaponShotEmitted(ABaseWeapon* Weapon);
+
+	/* Runs an input through the weapon action state machine and mirrors the resulting state into the flags */
+	EWeaponActionResult HandleWeaponActionInput(EWeaponActionInput Input, ABaseWeapon* Weapon = nullptr);
+
+	/* Sets bCanFire, bIsReloading and bIsChangingWeapon from the weapon action state */
+	void MirrorWeaponActionState();
+
+	/* Runs the inputs buffered during a reload or equip that the new state takes, in the order they were pressed */
+	void FlushBufferedWeaponInputs();
+
+private:
+
+	/* Called by the streamable manager once the backpack icons are loaded */
+	void OnBackpackIconsLoaded();
+
+	/* Copies changed inventory items into BackpackWeapons */
+	void OnBackpackItemsChanged(int32 ItemIndex);
+
+	/* Takes a weapon of the given class from the pool, attached to the FPP mesh */
+	ABaseWeapon* CheckOutWeapon(TSubclassOf<ABaseWeapon> WeaponClass);
+
+	/* Attaches a weapon to its socket of the FPP mesh, unless it already is */
+	void AttachWeaponToFPPMesh(ABaseWeapon* Weapon);
+
+	/* Fires one trigger shot of the current weapon at the given world time */
+	bool HandleTriggerShot(float ShotTime);
+
+	/* Plays one of our weapon timelines on the world's timeline scheduler */
+	void PlayWeaponTimeline(EWeaponTimelineType Type, UCurveFloat* Curve, float EventTime = -1.0f);
+
+private:
+
+	/* The weapon an equip is bringing up, from EquipWeapon until its weapon down event swaps it in */
 	ABaseWeapon* NewWeaponToEquip;
+
+	/* Idle, reloading or equipping, and the inputs waiting for it to allow them */
+	FWeaponActionStateMachine WeaponActionStateMachine;
+
+	/* Keeps the slotted weapon classes loaded */
+	TSharedPtr<FStreamableHandle> SlottedWeaponsHandle;
+
+	/* Keeps the backpack icons loaded until they are drawn into the atlas */
+	TSharedPtr<FStreamableHandle> BackpackIconsHandle;
+
+	/* The icons the atlas was built from, in cell order */
+	TArray<FStringAssetReference> AtlasIconPaths;
+
+	/* Atlas cell of every backpack item, or INDEX_NONE for items without an icon */
+	TArray<int32> BackpackItemAtlasCells;
+
+	/* The weapon action state and WeaponPullDownPercent packed by PreReplication */
+	UPROPERTY(ReplicatedUsing = OnRep_WeaponState)
+	FCharacterWeaponState ReplicatedWeaponState;
+
+	/* Shots fired so far, modulo 256; counted on the server, caught up with on clients */
+	uint8 BurstCounter = 0;
+
+	/* Has a weapon state been received yet ? The first one only sets BurstCounter */
+	bool bHasReceivedWeaponState = false;
+
+	/* The last processed action of the owning client and the slot ammo after it, packed by PreReplication */
+	UPROPERTY(ReplicatedUsing = OnRep_WeaponActionAck)
+	FWeaponActionAck WeaponActionAck;
+
+	/* Actions applied locally that the server has not acknowledged yet, oldest first; owning client only */
+	TArray<FPredictedWeaponAction> PendingWeaponActions;
+
+	/* Weapon the server put in hand while a predicted equip was pending, applied once it is acknowledged; owning client only */
+	TWeakObjectPtr<ABaseWeapon> DeferredCurrentWeapon;
+
+	/* Sequence of the last action sent to the server; owning client only */
+	uint16 WeaponActionSequence = 0;
+
+	/* Sequence of the last action processed; server only */
+	uint16 LastProcessedWeaponAction = 0;
+
+	/* Handle of this character in the lag compensation history, or INDEX_NONE; server only */
+	int32 LagCompensationHandle = INDEX_NONE;
+
+	/* Sequence of the reload and the equip being played, acknowledged when they finish, or INDEX_NONE; server only */
+	int32 PendingServerReload = INDEX_NONE;
+	int32 PendingServerEquip = INDEX_NONE;
+
+	/* Sequence and server time of the shot waiting for the weapon action state to allow it, or INDEX_NONE; server only */
+	int32 PendingServerFire = INDEX_NONE;
+	float PendingServerFireTime = 0.0f;
 };
@@ -7,6 +7,7 @@
 #include "GameplayPlayerStructs.h"
 #include "Runtime/Engine/Classes/Kismet/GameplayStatics.h"
 #include "GameplayPlayerCharacter.h"
+#include "OneEuroFilter.h"
 #include "Blueprint/UserWidget.h"
 #include "GameFramework/PlayerController.h"
 #include "GameplayPlayerController.generated.h"
@@ -19,6 +20,58 @@ enum class EControllingDeviceEnum : uint8
 	CDE_Gyro	UMETA(DisplayName="Gyro")
 };
 
+UENUM(BlueprintType)
+enum class ETouchFingerRole : uint8
+{
+	TFR_None	UMETA(DisplayName="None"),
+	TFR_Look	UMETA(DisplayName="Look"),
+	TFR_Fire	UMETA(DisplayName="Fire")
+};
+
+/* State of one finger on the touch screen, from Began to Ended */
+struct FTouchFingerState
+{
+	/* What this finger is used for, or TFR_None if it is not touching */
+	ETouchFingerRole Role;
+
+	/* Where the finger went down */
+	FVector2D StartLocation;
+
+	/* Where the finger was on its last event */
+	FVector2D LastLocation;
+
+	/* Movement received since the last frame, not applied yet */
+	FVector2D PendingDelta;
+
+	/* Real time at which the finger went down */
+	float StartTime;
+
+	FTouchFingerState()
+		: Role(ETouchFingerRole::TFR_None)
+		, StartLocation(ForceInitToZero)
+		, LastLocation(ForceInitToZero)
+		, PendingDelta(ForceInitToZero)
+		, StartTime(0.0f)
+	{
+	}
+};
+
+/* A tap or swipe recognized during the frame, dispatched in PlayerTick */
+struct FTouchGesture
+{
+	/* Is this a swipe rather than a tap ? */
+	bool bIsSwipe;
+
+	/* Where the gesture started */
+	FVector2D Location;
+
+	/* Normalized direction of a swipe */
+	FVector2D Direction;
+};
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FTouchTapDelegate, FVector2D, Location);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FTouchSwipeDelegate, FVector2D, StartLocation, FVector2D, Direction);
+
 /**
  * This class manages all stuff related to player controller behaviour
  */
@@ -73,6 +126,38 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "PlayerInput")
 	float TouchSensitivityCurrent;
 
+	/* Top left corner of the screen area where a finger fires instead of looking, in 0-1 viewport space */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "PlayerInput|Touch")
+	FVector2D TouchFireZoneMin = FVector2D(0.7f, 0.5f);
+
+	/* Bottom right corner of the screen area where a finger fires instead of looking, in 0-1 viewport space */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "PlayerInput|Touch")
+	FVector2D TouchFireZoneMax = FVector2D(1.0f, 1.0f);
+
+	/* A touch shorter than this, in seconds, may be a tap */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "PlayerInput|Touch")
+	float TapMaxDuration = 0.25f;
+
+	/* A touch moving less than this, in pixels, may be a tap */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "PlayerInput|Touch")
+	float TapMaxDistance = 20.0f;
+
+	/* A touch shorter than this, in seconds, may be a swipe */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "PlayerInput|Touch")
+	float SwipeMaxDuration = 0.5f;
+
+	/* A touch moving more than this, in pixels, may be a swipe */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "PlayerInput|Touch")
+	float SwipeMinDistance = 100.0f;
+
+	/* Called once per frame for every tap of a look finger */
+	UPROPERTY(BlueprintAssignable, Category = "PlayerInput|Touch")
+	FTouchTapDelegate OnTouchTapDelegate;
+
+	/* Called once per frame for every swipe of a look finger */
+	UPROPERTY(BlueprintAssignable, Category = "PlayerInput|Touch")
+	FTouchSwipeDelegate OnTouchSwipeDelegate;
+
 	/* Current sensitivity for mouse device */
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "PlayerInput")
 	float GyroSensitivityMin;
@@ -85,6 +170,18 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "PlayerInput")
 	float GyroSensitivityCurrent;
 
+	/* Aim from the integrated gyro rotation rate instead of the difference of two tilt samples */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "PlayerInput|Gyro")
+	bool bUseGyroRotationRate = true;
+
+	/* Smoothing of the gyro at rest, in Hz; lower removes more jitter */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "PlayerInput|Gyro", meta = (ClampMin = "0.01"))
+	float GyroFilterMinCutoff = 1.0f;
+
+	/* How fast the gyro smoothing opens up with rotation speed; higher lowers latency on fast turns */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "PlayerInput|Gyro", meta = (ClampMin = "0.0"))
+	float GyroFilterBeta = 0.05f;
+
 protected:
 
 	/* Sets default values for this character's properties */
@@ -96,6 +193,9 @@ protected:
 	/* Called to bind functionality to input */
 	virtual void SetupInputComponent() override;
 
+	/* Applies the input gathered since the last frame, then processes player input */
+	virtual void PlayerTick(float DeltaTime) override;
+
 	/* Handles a motion input event */
 	virtual bool InputMotion(const FVector& Tilt, const FVector& RotationRate, const FVector& Gravity, const FVector& Acceleration) override;
 
@@ -110,11 +210,11 @@ protected:
 
 public:
 
-	/* Gets current game player character instance */
+	/* Gets the character this controller possesses; player 0's character would be the host's on a listen server */
 	UFUNCTION(BlueprintCallable, Category = "Helpers")
 	FORCEINLINE AGameplayPlayerCharacter* GetGameplayPlayerCharacter() const
 	{
-		return Cast<AGameplayPlayerCharacter>(UGameplayStatics::GetPlayerCharacter(GetWorld(), 0));
+		return Cast<AGameplayPlayerCharacter>(GetPawn());
 	}
 
 	/* Gets current device */
@@ -136,16 +236,24 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "PlayerInput")
 	void SetSensitivity(const EControllingDeviceEnum WhichDevice, const float NewSensitivity);
 
-private:
+	/* Hides every cached menu, releases what they keep resident and gives the input back to the game; menus close through this */
+	UFUNCTION(BlueprintCallable, Category = "Widgets")
+	void HideMenus();
 
-	const int32 AlwaysAddKey = 0;
+private:
 
-	/* A Widget to change sensitivity menu */
+	/* A Widget to change sensitivity menu, created once and then shown and hidden */
+	UPROPERTY(Transient)
 	UUserWidget* ChangeSensitivityMenu;
 
-	/* A Widget to change weapon selection menu */
+	/* A Widget to change weapon selection menu, created once and then shown and hidden */
+	UPROPERTY(Transient)
 	UUserWidget* WeaponSelectionMenu;
 
+	/* The cached menu made visible last, until HideMenus collapses it */
+	UPROPERTY(Transient)
+	UUserWidget* ShownMenu;
+
 private:
 
 	/* Handles pressed O button event */
@@ -166,6 +274,50 @@ private:
 	/* Handles fire weapon button event */
 	void OnPressedLeftMouseButton();
 
+	/* Handles fire weapon button release event */
+	void OnReleasedLeftMouseButton();
+
 	/* Handles weapon selection menu event */
 	void OnShownWeaponSelectionMenu();
+
+	/* Creates one missing cached menu per frame until all exist, so BeginPlay does not hitch */
+	void PrecreateNextMenu();
+
+	/* Creates a menu and adds it to the viewport collapsed */
+	UUserWidget* CreateCachedMenu(TSubclassOf<UUserWidget> WidgetClass);
+
+	/* Shows the cached menu, or hides it if it is already shown; only its visibility changes, and OnMenuShown lets it read fresh data */
+	void ToggleCachedMenu(UUserWidget*& Menu, TSubclassOf<UUserWidget> WidgetClass);
+
+	/* Applies the coalesced look movement of every finger and dispatches the gestures of this frame */
+	void ProcessTouchFrame();
+
+	/* Applies the filtered gyro rotation integrated since the last frame */
+	void ProcessGyroFrame();
+
+	/* Is this screen location inside the fire zone ? */
+	bool IsInTouchFireZone(const FVector2D& TouchLocation) const;
+
+	/* Recognizes a tap or a swipe when a look finger is lifted */
+	void RecognizeTouchGesture(const FTouchFingerState& Finger, const FVector2D& EndLocation);
+
+private:
+
+	/* Every finger the touch screen can report */
+	FTouchFingerState TouchFingers[EKeys::NUM_TOUCH_KEYS];
+
+	/* Gestures recognized since the last frame; any beyond the capacity are dropped */
+	FTouchGesture PendingTouchGestures[EKeys::NUM_TOUCH_KEYS];
+
+	/* How many entries of PendingTouchGestures are used */
+	int32 NumPendingTouchGestures = 0;
+
+	/* Filters the gyro rotation rate before it is integrated */
+	FOneEuroFilter GyroRateFilter;
+
+	/* Gyro rotation integrated since the last frame, not applied yet */
+	FVector PendingGyroRotation = FVector::ZeroVector;
+
+	/* Platform time of the last motion sample, or zero before the first one */
+	double LastMotionTime = 0.0;
 };
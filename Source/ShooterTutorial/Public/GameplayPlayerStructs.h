@@ -10,11 +10,25 @@ struct FWeaponBackpackItem
 {
 	GENERATED_USTRUCT_BODY()
 
+	/* Hard weapon class of backpacks saved before WeaponToSpawnAsset; loaded so it can be migrated, never saved again */
+	UPROPERTY(meta = (DeprecatedProperty, DeprecationMessage = "Use WeaponToSpawnAsset"))
+	TSubclassOf<ABaseWeapon> WeaponToSpawn_DEPRECATED;
+
+	/* Hard icon of backpacks saved before BackpackImageAsset; loaded so it can be migrated, never saved again */
+	UPROPERTY(meta = (DeprecatedProperty, DeprecationMessage = "Use BackpackImageAsset"))
+	UTexture2D* BackpackImage_DEPRECATED;
+
+	/* The weapon, as a soft reference so weapons that are never slotted are never loaded */
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "PlayerWeapon")
-	TSubclassOf<ABaseWeapon> WeaponToSpawn;
+	TAssetSubclassOf<ABaseWeapon> WeaponToSpawnAsset;
 
+	/* The icon, loaded only while the weapon selection menu is open */
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "PlayerWeapon")
-	UTexture2D* BackpackImage;
+	TAssetPtr<UTexture2D> BackpackImageAsset;
+
+	/* Mirrors the weapon's type, so the backpack filters by type without loading the weapon */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "PlayerWeapon")
+	EWeaponType WeaponType;
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "PlayerWeapon")
 	bool bIsSelected;
@@ -24,9 +38,183 @@ struct FWeaponBackpackItem
 
 	FWeaponBackpackItem()
 	{
-		WeaponToSpawn = NULL;
-		BackpackImage = NULL;
+		WeaponToSpawn_DEPRECATED = NULL;
+		BackpackImage_DEPRECATED = NULL;
+		WeaponType = EWeaponType::WT_Pistol;
 		bIsSelected = false;
 		InSlot = 0;
 	}
+
+	/* Takes WeaponType from the weapon class if it is loaded; otherwise the authored value stays */
+	void UpdateWeaponType()
+	{
+		UClass* WeaponClass = WeaponToSpawnAsset.Get();
+		const ABaseWeapon* WeaponDefaults = WeaponClass ? WeaponClass->GetDefaultObject<ABaseWeapon>() : nullptr;
+		if (WeaponDefaults)
+		{
+			WeaponType = WeaponDefaults->GetWeaponType();
+		}
+	}
+
+	/* Moves the deprecated hard references into the soft ones left empty and drops them, so a resave or a cook keeps only the soft ones */
+	void MigrateToSoftReferences()
+	{
+		if (WeaponToSpawnAsset.IsNull() && WeaponToSpawn_DEPRECATED)
+		{
+			WeaponToSpawnAsset = WeaponToSpawn_DEPRECATED.Get();
+		}
+
+		if (BackpackImageAsset.IsNull() && BackpackImage_DEPRECATED)
+		{
+			BackpackImageAsset = BackpackImage_DEPRECATED;
+		}
+
+		WeaponToSpawn_DEPRECATED = NULL;
+		BackpackImage_DEPRECATED = NULL;
+	}
+};
+
+/* Reload and equip state of a character as sent over the network: three state bits and two bytes */
+USTRUCT()
+struct FCharacterWeaponState
+{
+	GENERATED_USTRUCT_BODY()
+
+	/* EWeaponActionState of the character */
+	UPROPERTY()
+	uint8 ActionState;
+
+	/* WeaponPullDownPercent quantized to 0-255 */
+	UPROPERTY()
+	uint8 WeaponPullDown;
+
+	/* Counts shots modulo 256, so clients play one fire effect per shot without a RPC per shot */
+	UPROPERTY()
+	uint8 BurstCounter;
+
+	FCharacterWeaponState()
+		: ActionState(0)
+		, WeaponPullDown(0)
+		, BurstCounter(0)
+	{
+	}
+
+	bool operator==(const FCharacterWeaponState& Other) const
+	{
+		return ActionState == Other.ActionState
+			&& WeaponPullDown == Other.WeaponPullDown
+			&& BurstCounter == Other.BurstCounter;
+	}
+
+	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess)
+	{
+		uint8 PackedState = ActionState & 0x07;
+		Ar.SerializeBits(&PackedState, 3);
+
+		if (Ar.IsLoading())
+		{
+			ActionState = PackedState;
+		}
+
+		Ar << WeaponPullDown;
+		Ar << BurstCounter;
+
+		bOutSuccess = true;
+		return true;
+	}
+};
+
+template<>
+struct TStructOpsTypeTraits<FCharacterWeaponState> : public TStructOpsTypeTraitsBase2<FCharacterWeaponState>
+{
+	enum
+	{
+		WithNetSerializer = true,
+		WithIdenticalViaEquality = true,
+	};
+};
+
+/* What a predicted weapon action did */
+UENUM()
+enum class EWeaponActionType : uint8
+{
+	WAT_Fire,
+	WAT_Reload,
+	WAT_Equip
+};
+
+/* A fire, reload or equip the owning client applied before the server confirmed it */
+struct FPredictedWeaponAction
+{
+	/* Sequence number the action was sent to the server with */
+	uint16 Sequence;
+
+	EWeaponActionType Type;
+
+	/* The weapon the action was applied to */
+	TWeakObjectPtr<ABaseWeapon> Weapon;
+
+	/* Has the client applied the action's ammo change yet ? Reloads refill only once their timeline ends */
+	bool bApplied;
+
+	FPredictedWeaponAction(uint16 InSequence, EWeaponActionType InType, ABaseWeapon* InWeapon)
+		: Sequence(InSequence)
+		, Type(InType)
+		, Weapon(InWeapon)
+		, bApplied(InType != EWeaponActionType::WAT_Reload)
+	{
+	}
+};
+
+/* The server's answer to the owning client: the last action it processed and the slot ammo right after it */
+USTRUCT()
+struct FWeaponActionAck
+{
+	GENERATED_USTRUCT_BODY()
+
+	UPROPERTY()
+	uint16 Sequence;
+
+	/* Ammo of WeaponSlot1, WeaponSlot2 and WeaponSlot3 */
+	UPROPERTY()
+	FWeaponAmmoState SlotAmmo[3];
+
+	FWeaponActionAck()
+		: Sequence(0)
+	{
+	}
+
+	/* Is sequence A later than sequence B ? Works across wrap around as long as they are less than 32768 apart */
+	static bool IsNewer(uint16 A, uint16 B)
+	{
+		return (int16)(A - B) > 0;
+	}
+
+	bool operator==(const FWeaponActionAck& Other) const
+	{
+		return Sequence == Other.Sequence && SlotAmmo[0] == Other.SlotAmmo[0] && SlotAmmo[1] == Other.SlotAmmo[1] && SlotAmmo[2] == Other.SlotAmmo[2];
+	}
+
+	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess)
+	{
+		Ar << Sequence;
+
+		for (FWeaponAmmoState& Ammo : SlotAmmo)
+		{
+			Ammo.NetSerialize(Ar, Map, bOutSuccess);
+		}
+
+		bOutSuccess = true;
+		return true;
+	}
+};
+
+template<>
+struct TStructOpsTypeTraits<FWeaponActionAck> : public TStructOpsTypeTraitsBase2<FWeaponActionAck>
+{
+	enum
+	{
+		WithNetSerializer = true,
+		WithIdenticalViaEquality = true,
+	};
 };
@@ -0,0 +1,30 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/Object.h"
+#include "Tickable.h"
+#include "GameplayWorldManager.generated.h"
+
+/**
+ * Base class of the per world managers owned by AGameplayGameState.
+ * Managers that need a per frame update override Tick; the tick runs once
+ * per frame after every actor of their world has ticked.
+ */
+UCLASS(Abstract)
+class SHOOTERTUTORIAL_API UGameplayWorldManager : public UObject, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+
+	/* UObject interface */
+	virtual UWorld* GetWorld() const override;
+
+	/* FTickableGameObject interface */
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override;
+};
@@ -0,0 +1,117 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameplayWorldManager.h"
+#include "Engine/EngineTypes.h"
+#include "LagCompensationManager.generated.h"
+
+class ACharacter;
+
+/**
+ * Server side history of where every character's capsule was. Every
+ * RecordInterval the location, rotation and capsule size of every target
+ * are written into a fixed ring of LagCompensationHistorySize frames, so
+ * the history covers the same time whatever the tick rate, stored as parallel arrays
+ * so a target costs a bounded few kilobytes. A rewind query interpolates
+ * every target between the two frames around the requested time and
+ * intersects the ray with the capsules analytically, so nothing is re-posed
+ * or moved in the physics scene.
+ */
+UCLASS()
+class SHOOTERTUTORIAL_API ULagCompensationManager : public UGameplayWorldManager
+{
+	GENERATED_BODY()
+
+public:
+
+	/* Gets the lag compensation manager of the given world, if the world uses AGameplayGameState */
+	static ULagCompensationManager* Get(const UWorld* World);
+
+	/* Starts recording a character and returns its handle */
+	int32 AddTarget(ACharacter* Character);
+
+	/* Stops recording a character; its handle may be reused */
+	void RemoveTarget(int32 Handle);
+
+	/* Is this handle a recorded character ? */
+	FORCEINLINE bool IsValidTarget(int32 Handle) const
+	{
+		return Targets.IsValidIndex(Handle) && Targets[Handle].IsValid();
+	}
+
+	/* How many characters are recorded */
+	FORCEINLINE int32 GetNumTargets() const
+	{
+		return Targets.Num() - FreeHandles.Num();
+	}
+
+	/* Gets every recorded character, for traces that should leave them to the rewind */
+	void GetTargetActors(TArray<AActor*>& OutActors) const;
+
+	/* Clamps a shot time into the recorded history; shots cannot be rewound further than MaxRewindTime */
+	float ClampRewindTime(float Timestamp) const;
+
+	/* Traces a ray against every target as it was at Timestamp; returns true and the closest hit if one was hit */
+	bool RewindLineTrace(float Timestamp, const FVector& Start, const FVector& End, const AActor* IgnoredActor, FHitResult& OutHit) const;
+
+	/* How far back the ring reaches, in seconds */
+	float GetHistoryDuration() const;
+
+	/* Bytes allocated by the history */
+	SIZE_T GetAllocatedSize() const;
+
+public:
+
+	/* The furthest back a shot may be rewound, in seconds */
+	UPROPERTY(EditAnywhere, Category = "LagCompensation")
+	float MaxRewindTime = 0.5f;
+
+	/* Time between two recorded frames, in seconds; the history spans LagCompensationHistorySize of them */
+	UPROPERTY(EditAnywhere, Category = "LagCompensation", meta = (ClampMin = "0.001"))
+	float RecordInterval = 1.0f / 60.0f;
+
+public:
+
+	/* UGameplayWorldManager interface */
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+
+private:
+
+	/* Writes the current pose of every target into the head frame */
+	void RecordFrame();
+
+	/* Finds the recorded frames around a time and how far between them it lies; false if nothing is recorded */
+	bool FindFrames(float Timestamp, uint32& OutOlderFrame, uint32& OutNewerFrame, float& OutAlpha) const;
+
+	/* Index of a target's sample of an absolute frame in the per sample arrays */
+	FORCEINLINE int32 GetSampleIndex(int32 Handle, uint32 Frame) const;
+
+private:
+
+	/* Recorded characters, one per handle */
+	TArray<TWeakObjectPtr<ACharacter>> Targets;
+
+	/* First absolute frame recorded for every handle */
+	TArray<uint32> FirstFrames;
+
+	/* Handles of removed targets, ready to be reused */
+	TArray<int32> FreeHandles;
+
+	/* World time of every frame of the ring */
+	TArray<float> FrameTimes;
+
+	/* Per sample history, LagCompensationHistorySize samples per handle */
+	TArray<FVector> Locations;
+	TArray<FQuat> Rotations;
+	TArray<FVector2D> CapsuleSizes;
+
+	/* How many frames have been recorded; the head frame is NumFrames - 1 */
+	uint32 NumFrames = 0;
+
+	/* Time since the head frame was recorded */
+	float TimeSinceRecord = 0.0f;
+};
@@ -0,0 +1,76 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * One Euro filter (Casiez et al.) over a vector signal. It smooths hard
+ * while the signal is slow, which removes jitter, and opens up while it is
+ * fast, which keeps latency low. MinCutoff sets the smoothing at rest in Hz,
+ * Beta how quickly the cutoff rises with speed.
+ */
+struct FOneEuroFilter
+{
+	/* Cutoff frequency at rest, in Hz */
+	float MinCutoff;
+
+	/* How much the cutoff rises per unit of signal speed */
+	float Beta;
+
+	/* Cutoff frequency of the speed estimate, in Hz */
+	float DerivativeCutoff;
+
+	FOneEuroFilter()
+		: MinCutoff(1.0f)
+		, Beta(0.0f)
+		, DerivativeCutoff(1.0f)
+		, PreviousValue(ForceInitToZero)
+		, PreviousDerivative(ForceInitToZero)
+		, bHasPrevious(false)
+	{
+	}
+
+	/* Filters one sample taken DeltaTime seconds after the previous one */
+	FVector Filter(const FVector& Value, float DeltaTime)
+	{
+		if (!bHasPrevious || DeltaTime <= 0.0f)
+		{
+			PreviousValue = Value;
+			PreviousDerivative = FVector::ZeroVector;
+			bHasPrevious = true;
+			return Value;
+		}
+
+		const FVector Derivative = (Value - PreviousValue) / DeltaTime;
+		PreviousDerivative = FMath::Lerp(PreviousDerivative, Derivative, Alpha(DerivativeCutoff, DeltaTime));
+
+		const float Cutoff = MinCutoff + Beta * PreviousDerivative.Size();
+		PreviousValue = FMath::Lerp(PreviousValue, Value, Alpha(Cutoff, DeltaTime));
+		return PreviousValue;
+	}
+
+	/* Forgets the history, the next sample passes through unfiltered */
+	void Reset()
+	{
+		bHasPrevious = false;
+	}
+
+private:
+
+	/* Smoothing factor of a first order low pass at the given cutoff */
+	static float Alpha(float Cutoff, float DeltaTime)
+	{
+		const float Tau = 1.0f / (2.0f * PI * FMath::Max(Cutoff, KINDA_SMALL_NUMBER));
+		return 1.0f / (1.0f + Tau / DeltaTime);
+	}
+
+	/* Last filtered value */
+	FVector PreviousValue;
+
+	/* Last filtered speed */
+	FVector PreviousDerivative;
+
+	/* Has a sample been filtered since the last reset ? */
+	bool bHasPrevious;
+};
@@ -0,0 +1,105 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameplayWorldManager.h"
+#include "BaseProjectile.h"
+#include "ProjectilePool.generated.h"
+
+/* Occupancy counters of the pool of one projectile class */
+USTRUCT(BlueprintType)
+struct FProjectilePoolStats
+{
+	GENERATED_USTRUCT_BODY()
+
+	/* Projectiles currently in flight */
+	UPROPERTY(BlueprintReadOnly, Category = "ProjectilePool")
+	int32 NumActive;
+
+	/* Projectiles waiting in the pool */
+	UPROPERTY(BlueprintReadOnly, Category = "ProjectilePool")
+	int32 NumFree;
+
+	/* Most projectiles that were in flight at the same time */
+	UPROPERTY(BlueprintReadOnly, Category = "ProjectilePool")
+	int32 PeakActive;
+
+	/* How many times the pool was empty and a projectile had to be spawned */
+	UPROPERTY(BlueprintReadOnly, Category = "ProjectilePool")
+	int32 NumMisses;
+
+	FProjectilePoolStats()
+	{
+		NumActive = 0;
+		NumFree = 0;
+		PeakActive = 0;
+		NumMisses = 0;
+	}
+};
+
+/* The pooled projectiles of one projectile class */
+USTRUCT()
+struct FProjectilePoolBucket
+{
+	GENERATED_USTRUCT_BODY()
+
+	/* Deactivated projectiles ready to be handed out */
+	UPROPERTY()
+	TArray<ABaseProjectile*> FreeProjectiles;
+
+	/* Occupancy counters of this bucket */
+	UPROPERTY()
+	FProjectilePoolStats Stats;
+};
+
+/**
+ * Per world pool of projectile actors. Projectiles are spawned up front,
+ * handed out when a weapon fires and given back (reset and deactivated)
+ * instead of being destroyed, so firing never spawns or garbage collects.
+ */
+UCLASS()
+class SHOOTERTUTORIAL_API UProjectilePool : public UGameplayWorldManager
+{
+	GENERATED_BODY()
+
+public:
+
+	/* Gets the projectile pool of the given world, if the world uses AGameplayGameState */
+	static UProjectilePool* Get(const UWorld* World);
+
+	/* Spawns projectiles of the given class until at least Count of them exist */
+	UFUNCTION(BlueprintCallable, Category = "ProjectilePool")
+	void Prewarm(TSubclassOf<ABaseProjectile> ProjectileClass, int32 Count);
+
+	/* Hands out a projectile of the given class and launches it from the given transform, CatchUpTime seconds into its flight */
+	UFUNCTION(BlueprintCallable, Category = "ProjectilePool")
+	ABaseProjectile* Acquire(TSubclassOf<ABaseProjectile> ProjectileClass, const FTransform& LaunchTransform, AActor* NewOwner, APawn* NewInstigator, float CatchUpTime = 0.0f);
+
+	/* Gives a projectile back to the pool */
+	UFUNCTION(BlueprintCallable, Category = "ProjectilePool")
+	void Release(ABaseProjectile* Projectile);
+
+	/* Gets the occupancy counters of the pool of the given class */
+	UFUNCTION(BlueprintCallable, Category = "ProjectilePool")
+	FProjectilePoolStats GetPoolStats(TSubclassOf<ABaseProjectile> ProjectileClass) const;
+
+	/* Writes the counters of every pool to the log */
+	void DumpPoolStats() const;
+
+public:
+
+	/* FTickableGameObject interface */
+	virtual bool IsTickable() const override;
+
+private:
+
+	/* Spawns a deactivated projectile of the given class */
+	ABaseProjectile* SpawnPooledProjectile(UClass* ProjectileClass);
+
+private:
+
+	/* One bucket per projectile class */
+	UPROPERTY()
+	TMap<UClass*, FProjectilePoolBucket> Buckets;
+};
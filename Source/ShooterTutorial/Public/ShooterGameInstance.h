@@ -4,17 +4,51 @@
 
 #include "CoreMinimal.h"
 #include "Engine/GameInstance.h"
+#include "Engine/StreamableManager.h"
+#include "WeaponCatalog.h"
 #include "ShooterGameInstance.generated.h"
 
 /**
- * 
+ * Game instance of the shooter. Holds the data that lives as long as the
+ * game does, like the weapon catalog.
  */
-UCLASS()
+UCLASS(Config = Game)
 class SHOOTERTUTORIAL_API UShooterGameInstance : public UGameInstance
 {
 	GENERATED_BODY()
-	
-	
-	
-	
+
+public:
+
+	/* The weapon catalog every weapon reads its stats from */
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Weapons")
+	TAssetPtr<UWeaponCatalog> WeaponCatalogAsset;
+
+public:
+
+	/* Gets the loaded weapon catalog, if one is configured */
+	UFUNCTION(BlueprintCallable, Category = "Weapons")
+	FORCEINLINE UWeaponCatalog* GetWeaponCatalog() const
+	{
+		return WeaponCatalog;
+	}
+
+	/* The streamable manager gameplay code loads soft referenced assets through */
+	FORCEINLINE FStreamableManager& GetStreamableManager()
+	{
+		return StreamableManager;
+	}
+
+public:
+
+	/* Called when the game instance is created */
+	virtual void Init() override;
+
+private:
+
+	/* The weapon catalog, loaded on Init */
+	UPROPERTY(Transient)
+	UWeaponCatalog* WeaponCatalog;
+
+	/* Loads soft referenced assets asynchronously and keeps them alive while they are requested */
+	FStreamableManager StreamableManager;
 };
@@ -0,0 +1,109 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "ShooterSoakDriver.generated.h"
+
+class AGameplayPlayerCharacter;
+
+/**
+ * Headless soak test. Spawns a crowd of player characters with their
+ * backpack loadouts, drives them through scripted fire, reload and equip
+ * cycles and writes average and p99 game thread frame time plus the memory
+ * high water mark as JSON to Saved/Soak. Spawned by AGameplayGameMode when
+ * the game runs with -ShooterSoak, for example:
+ *   ShooterTutorial -game -nullrhi -unattended -ShooterSoak -ShooterSoakCharacters=64 -ShooterSoakSeconds=60
+ */
+UCLASS(Config = Game)
+class SHOOTERTUTORIAL_API AShooterSoakDriver : public AActor
+{
+	GENERATED_BODY()
+
+public:
+
+	/* The character spawned for every simulated player; overridden by -ShooterSoakCharacterClass= */
+	UPROPERTY(Config, EditAnywhere, Category = "Soak", meta = (MetaClass = "GameplayPlayerCharacter"))
+	FStringClassReference CharacterClass;
+
+	/* How many characters to simulate; overridden by -ShooterSoakCharacters= */
+	UPROPERTY(Config, EditAnywhere, Category = "Soak", meta = (ClampMin = "1"))
+	int32 NumCharacters = 32;
+
+	/* Seconds before measuring starts, so spawning and pool growth are not measured */
+	UPROPERTY(Config, EditAnywhere, Category = "Soak")
+	float WarmupSeconds = 5.0f;
+
+	/* Seconds to measure for; overridden by -ShooterSoakSeconds= */
+	UPROPERTY(Config, EditAnywhere, Category = "Soak")
+	float MeasureSeconds = 60.0f;
+
+	/* Seconds between two scripted actions of a character */
+	UPROPERTY(Config, EditAnywhere, Category = "Soak")
+	float ActionInterval = 0.5f;
+
+	/* Distance between two characters of the spawn grid */
+	UPROPERTY(Config, EditAnywhere, Category = "Soak")
+	float SpawnSpacing = 200.0f;
+
+	/* Quit the game once the report is written */
+	UPROPERTY(EditAnywhere, Category = "Soak")
+	bool bQuitWhenDone = true;
+
+public:
+
+	/* Sets default values for this actor's properties */
+	AShooterSoakDriver();
+
+	/* Should the game mode spawn a soak driver ? */
+	static bool IsRequestedOnCommandLine();
+
+protected:
+
+	/* Called when the game starts or when spawned */
+	virtual void BeginPlay() override;
+
+public:
+
+	/* Called every frame */
+	virtual void Tick(float DeltaTime) override;
+
+private:
+
+	/* Spawns the characters in a grid around the driver and gives them their loadouts */
+	void SpawnCharacters();
+
+	/* Runs the next scripted action of one character */
+	void RunScriptedAction(AGameplayPlayerCharacter* Character, int32 CharacterIndex);
+
+	/* Writes the JSON report and optionally quits */
+	void FinishSoak();
+
+private:
+
+	/* The simulated characters */
+	UPROPERTY(Transient)
+	TArray<AGameplayPlayerCharacter*> Characters;
+
+	/* Game thread time of every measured frame, in milliseconds */
+	TArray<float> FrameTimesMs;
+
+	/* Highest physical memory use seen while measuring */
+	uint64 PeakUsedPhysical = 0;
+
+	/* Highest virtual memory use seen while measuring */
+	uint64 PeakUsedVirtual = 0;
+
+	/* Seconds since the soak started */
+	float ElapsedSeconds = 0.0f;
+
+	/* Seconds until the next scripted step */
+	float ActionCountdown = 0.0f;
+
+	/* How many scripted steps have run */
+	int32 ActionStep = 0;
+
+	/* Set once the report was written */
+	bool bFinished = false;
+};
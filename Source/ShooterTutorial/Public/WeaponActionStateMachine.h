@@ -0,0 +1,103 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "WeaponActionStateMachine.generated.h"
+
+class ABaseWeapon;
+
+/* What a character's weapon is busy with */
+UENUM(BlueprintType)
+enum class EWeaponActionState : uint8
+{
+	WAS_Unarmed		UMETA(DisplayName = "Unarmed"),
+	WAS_Idle		UMETA(DisplayName = "Idle"),
+	WAS_Reloading	UMETA(DisplayName = "Reloading"),
+	WAS_Equipping	UMETA(DisplayName = "Equipping"),
+	WAS_Count		UMETA(Hidden)
+};
+
+/* What can happen to a character's weapon; the first NumBufferedWeaponInputs are player inputs and may be buffered */
+enum class EWeaponActionInput : uint8
+{
+	WAI_Fire,
+	WAI_Reload,
+	WAI_Equip,
+	WAI_ReloadFinished,
+	WAI_EquipFinished,
+	WAI_Armed,
+	WAI_Disarmed,
+	WAI_Count
+};
+
+/* What the state machine does with an input in a state */
+enum class EWeaponActionResult : uint8
+{
+	/* The input is ignored */
+	WAR_Refuse,
+	/* The input runs now and the state moves on */
+	WAR_Execute,
+	/* The input is kept and runs as soon as the state allows it */
+	WAR_Buffer
+};
+
+/* One cell of the transition table */
+struct FWeaponActionTransition
+{
+	EWeaponActionResult Result;
+
+	/* The state after the input, if it is executed */
+	EWeaponActionState NextState;
+};
+
+/* How many inputs may be buffered: fire, reload and equip */
+static const int32 NumBufferedWeaponInputs = 3;
+
+/**
+ * Weapon action state of a character. Every input is one lookup in a
+ * state by input transition table, which says whether it runs now, waits
+ * in the buffer or is ignored. Each bufferable input keeps only its latest
+ * press, and PopReadyInput hands them back, oldest first, once the state
+ * takes them.
+ */
+struct FWeaponActionStateMachine
+{
+	FWeaponActionStateMachine();
+
+	/* The table cell of an input in a state */
+	static const FWeaponActionTransition& GetTransition(EWeaponActionState State, EWeaponActionInput Input);
+
+	/* Looks the input up in the current state: executes it, buffers it with its press time or refuses it */
+	EWeaponActionResult HandleInput(EWeaponActionInput Input, float Time, ABaseWeapon* Weapon = nullptr);
+
+	/* Drops inputs pressed more than BufferTime before Time and takes the oldest one the current state executes */
+	bool PopReadyInput(float Time, float BufferTime, EWeaponActionInput& OutInput, ABaseWeapon*& OutWeapon);
+
+	/* Is an input waiting in the buffer ? */
+	bool IsBuffered(EWeaponActionInput Input) const;
+
+	/* Forgets every buffered input */
+	void ClearBuffer();
+
+	FORCEINLINE EWeaponActionState GetState() const
+	{
+		return State;
+	}
+
+	/* Forces a state, as received from the server */
+	FORCEINLINE void SetState(EWeaponActionState NewState)
+	{
+		State = NewState;
+	}
+
+private:
+
+	EWeaponActionState State;
+
+	/* World time every bufferable input was last pressed, or negative if it is not buffered */
+	float BufferedPressTimes[NumBufferedWeaponInputs];
+
+	/* The weapon of the buffered equip */
+	TWeakObjectPtr<ABaseWeapon> BufferedEquipWeapon;
+};
@@ -0,0 +1,28 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "WeaponBenchCommandlet.generated.h"
+
+/**
+ * Microbenchmark of the weapon and backpack state transitions. Runs every
+ * operation natively and through reflection (ProcessEvent), and
+ * BlueprintNativeEvents also through their generated thunk, then prints
+ * ns/op and allocations/op. No map and no renderer are needed:
+ *   UE4Editor-Cmd ShooterTutorial -run=WeaponBench -Iterations=1000000
+ */
+UCLASS()
+class SHOOTERTUTORIAL_API UWeaponBenchCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+
+	/* Sets default values for this commandlet's properties */
+	UWeaponBenchCommandlet();
+
+	/* UCommandlet interface */
+	virtual int32 Main(const FString& Params) override;
+};
@@ -0,0 +1,128 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "Engine/DataTable.h"
+#include "BaseWeapon.h"
+#include "WeaponCatalog.generated.h"
+
+/* Balancing values shared by every weapon of one kind; one row of the weapon stats table */
+USTRUCT(BlueprintType)
+struct FWeaponStats : public FTableRowBase
+{
+	GENERATED_USTRUCT_BODY()
+
+	/* How much ammo we can have in the magazine */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Ammunition")
+	int32 MaxAmmoInMag;
+
+	/* How much ammo we can have in the backpack */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Ammunition")
+	int32 MaxAmmoInBackpack;
+
+	/* How much time is needed to reload the weapon */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Ammunition")
+	float ReloadTime;
+
+	/* The socket this weapon will be attached to in FPP mesh */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Socket")
+	FName AttachSocketNameFPP;
+
+	/* The socket this weapon will be attached to in TPP mesh */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Socket")
+	FName AttachSocketNameTPP;
+
+	/* The type of weapon this weapon is */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Weapon")
+	EWeaponType WeaponType;
+
+	FWeaponStats()
+	{
+		MaxAmmoInMag = 6;
+		MaxAmmoInBackpack = 30;
+		ReloadTime = 2.0f;
+		AttachSocketNameFPP = FName(TEXT("WeaponPoint"));
+		AttachSocketNameTPP = FName(TEXT("WeaponPoint"));
+		WeaponType = EWeaponType::WT_Pistol;
+	}
+};
+
+/**
+ * Read only catalog of weapon stats. Designers balance weapons in a data
+ * table of FWeaponStats rows; the catalog bakes that table into a packed
+ * array when it is saved or cooked, and weapons only keep a row name (their
+ * weapon id) resolved once to an index into that array.
+ */
+UCLASS(BlueprintType)
+class SHOOTERTUTORIAL_API UWeaponCatalog : public UDataAsset
+{
+	GENERATED_BODY()
+
+public:
+
+	/* The table the catalog is baked from; rows must be FWeaponStats */
+	UPROPERTY(EditAnywhere, Category = "Catalog")
+	UDataTable* SourceTable;
+
+public:
+
+	/* Gets the catalog used by the game instance of the given world */
+	static UWeaponCatalog* Get(const UWorld* World);
+
+	/* Rebuilds the packed stats from the source table */
+	UFUNCTION(BlueprintCallable, Category = "Catalog")
+	void Bake();
+
+	/* Finds the index of a weapon id, or INDEX_NONE */
+	int32 FindWeaponIndex(FName WeaponId) const;
+
+	/* Gets the stats at an index returned by FindWeaponIndex, or nullptr */
+	FORCEINLINE const FWeaponStats* GetStats(int32 WeaponIndex) const
+	{
+		return BakedStats.IsValidIndex(WeaponIndex) ? &BakedStats[WeaponIndex] : nullptr;
+	}
+
+	/* How many weapons the catalog holds */
+	FORCEINLINE int32 GetNumWeapons() const
+	{
+		return BakedStats.Num();
+	}
+
+	/* Changes with every bake; indices resolved under another version must be looked up again */
+	FORCEINLINE uint32 GetBakeVersion() const
+	{
+		return BakeVersion;
+	}
+
+public:
+
+	/* UObject interface */
+	virtual void PostLoad() override;
+	virtual void PreSave(const class ITargetPlatform* TargetPlatform) override;
+#if WITH_EDITOR
+	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif
+
+private:
+
+	/* Rebuilds the id to index lookup from the baked ids */
+	void BuildIndex();
+
+private:
+
+	/* Weapon ids, in the same order as BakedStats */
+	UPROPERTY()
+	TArray<FName> BakedIds;
+
+	/* Packed stats, indexed by weapon index */
+	UPROPERTY()
+	TArray<FWeaponStats> BakedStats;
+
+	/* Weapon id to weapon index lookup */
+	TMap<FName, int32> IdToIndex;
+
+	/* How many times the index was built; adding or removing a row shifts the indices after it */
+	uint32 BakeVersion = 0;
+};
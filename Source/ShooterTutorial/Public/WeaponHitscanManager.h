@@ -0,0 +1,105 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameplayWorldManager.h"
+#include "Engine/EngineTypes.h"
+#include "WorldCollision.h"
+#include "WeaponHitscanManager.generated.h"
+
+class ABaseWeapon;
+
+/* A single hitscan ray waiting to be traced */
+struct FHitscanShot
+{
+	/* The weapon that fired this shot */
+	TWeakObjectPtr<ABaseWeapon> Weapon;
+
+	/* Where the ray starts */
+	FVector Start;
+
+	/* Where the ray ends */
+	FVector End;
+
+	/* World time at which the shot was fired */
+	float Timestamp;
+
+	/* Collision channel used for the trace */
+	TEnumAsByte<ECollisionChannel> Channel;
+
+	/* Did the ray hit a character as it was at Timestamp ? The world trace then ignores every character */
+	bool bHasRewoundHit;
+
+	/* The closest character hit at Timestamp, if bHasRewoundHit */
+	FHitResult RewoundHit;
+
+	FHitscanShot()
+		: Start(ForceInitToZero)
+		, End(ForceInitToZero)
+		, Timestamp(0.0f)
+		, Channel(ECC_Visibility)
+		, bHasRewoundHit(false)
+	{
+	}
+};
+
+/**
+ * Collects every hitscan shot fired during a frame by any ABaseWeapon and
+ * resolves them as one batch of async world traces. Results are handed back
+ * to the weapons on the next frame through ABaseWeapon::OnHitscanResolved.
+ * Where the world records lag compensation, characters are left out of the
+ * world traces and hit where they were at the shot's timestamp instead.
+ */
+UCLASS()
+class SHOOTERTUTORIAL_API UWeaponHitscanManager : public UGameplayWorldManager
+{
+	GENERATED_BODY()
+
+public:
+
+	/* Gets the hitscan manager of the given world, if the world uses AGameplayGameState */
+	static UWeaponHitscanManager* Get(const UWorld* World);
+
+	/* Queues a shot; it will be traced together with all other shots of this frame */
+	void QueueShot(ABaseWeapon* Weapon, const FVector& Start, const FVector& End, ECollisionChannel Channel, float Timestamp);
+
+	/* How many shots are waiting to be submitted this frame */
+	FORCEINLINE int32 GetNumQueuedShots() const
+	{
+		return QueuedShots.Num();
+	}
+
+	/* How many shots were submitted and are waiting for their results */
+	FORCEINLINE int32 GetNumInFlightShots() const
+	{
+		return InFlightShots.Num();
+	}
+
+public:
+
+	UWeaponHitscanManager();
+
+	/* UGameplayWorldManager interface */
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+private:
+
+	/* Submits every queued shot of this frame to the async trace system */
+	void FlushQueuedShots();
+
+	/* Called by the async trace system on the next frame */
+	void OnTraceCompleted(const FTraceHandle& TraceHandle, FTraceDatum& TraceDatum);
+
+private:
+
+	/* Shots fired this frame, not yet submitted */
+	TArray<FHitscanShot> QueuedShots;
+
+	/* Submitted shots waiting for a result; the index is passed as trace user data */
+	TSparseArray<FHitscanShot> InFlightShots;
+
+	/* The delegate shared by every trace of the batch */
+	FTraceDelegate TraceDelegate;
+};
@@ -0,0 +1,58 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameplayWorldManager.h"
+#include "BaseWeapon.h"
+#include "WeaponPool.generated.h"
+
+/* The pooled weapons of one weapon class */
+USTRUCT()
+struct FWeaponPoolBucket
+{
+	GENERATED_USTRUCT_BODY()
+
+	/* Checked in weapons ready to be handed out */
+	UPROPERTY()
+	TArray<ABaseWeapon*> FreeWeapons;
+};
+
+/**
+ * Per world pool of weapon actors keyed by weapon class. Characters check
+ * their slot weapons out when they get a loadout and check them back in on
+ * loadout changes and respawns, so weapons are spawned once per match.
+ */
+UCLASS()
+class SHOOTERTUTORIAL_API UWeaponPool : public UGameplayWorldManager
+{
+	GENERATED_BODY()
+
+public:
+
+	/* Gets the weapon pool of the given world, if the world uses AGameplayGameState */
+	static UWeaponPool* Get(const UWorld* World);
+
+	/* Hands out a weapon of the given class, owned by NewOwner and attached to its FPP socket on AttachParent */
+	UFUNCTION(BlueprintCallable, Category = "WeaponPool")
+	ABaseWeapon* CheckOut(TSubclassOf<ABaseWeapon> WeaponClass, APawn* NewOwner, USceneComponent* AttachParent);
+
+	/* Gives a weapon back to the pool */
+	UFUNCTION(BlueprintCallable, Category = "WeaponPool")
+	void CheckIn(ABaseWeapon* Weapon);
+
+	/* How many weapons of the given class are waiting in the pool */
+	UFUNCTION(BlueprintCallable, Category = "WeaponPool")
+	int32 GetNumFreeWeapons(TSubclassOf<ABaseWeapon> WeaponClass) const;
+
+public:
+
+	/* FTickableGameObject interface */
+	virtual bool IsTickable() const override;
+
+private:
+
+	/* One bucket per weapon class */
+	UPROPERTY()
+	TMap<UClass*, FWeaponPoolBucket> Buckets;
+};
@@ -0,0 +1,166 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameplayWorldManager.h"
+#include "WeaponStateStore.generated.h"
+
+class ABaseWeapon;
+
+/* Stats an agent of the weapon state store is created with */
+struct FWeaponAgentDesc
+{
+	/* How much ammo fits in the magazine */
+	int32 MaxAmmoInMag;
+
+	/* How much ammo fits in the backpack */
+	int32 MaxAmmoInBackpack;
+
+	/* Seconds a reload takes when the store times it */
+	float ReloadTime;
+
+	/* Seconds between two shots; zero fires every requested shot */
+	float FireInterval;
+
+	FWeaponAgentDesc()
+		: MaxAmmoInMag(6)
+		, MaxAmmoInBackpack(30)
+		, ReloadTime(2.0f)
+		, FireInterval(0.0f)
+	{
+	}
+};
+
+/* Bits of the per agent flags */
+namespace EWeaponAgentFlags
+{
+	enum Type : uint8
+	{
+		Alive			= 1 << 0,
+		CanFire			= 1 << 1,
+		Reloading		= 1 << 2,
+		ChangingWeapon	= 1 << 3,
+		TriggerHeld		= 1 << 4,
+		WantsReload		= 1 << 5,
+		/* Reloads come from ApplyReload only; set for agents with a view, whose character times the reload */
+		ManualReload	= 1 << 6,
+	};
+}
+
+/**
+ * Optional data oriented home for weapon state. Ammo, reload, cooldown and
+ * fire flags of every agent are stored in parallel arrays and simulated as
+ * one ParallelFor batch per frame. Headless bots can live here without any
+ * actor; an ABaseWeapon bound to an agent becomes a thin view whose ammo is
+ * written back after each batch. Enabled with Shooter.WeaponStateStore 1.
+ */
+UCLASS()
+class SHOOTERTUTORIAL_API UWeaponStateStore : public UGameplayWorldManager
+{
+	GENERATED_BODY()
+
+public:
+
+	/* Gets the weapon state store of the given world, if the world uses AGameplayGameState */
+	static UWeaponStateStore* Get(const UWorld* World);
+
+	/* Should weapons bind to the store ? */
+	static bool IsEnabled();
+
+	/* Adds an agent with full ammo and returns its handle; View may be null for headless agents */
+	int32 AddAgent(const FWeaponAgentDesc& Desc, ABaseWeapon* View = nullptr);
+
+	/* Gives the agent full ammo and clears its state, as if it was just added */
+	void ResetAgent(int32 Handle, const FWeaponAgentDesc& Desc);
+
+	/* Removes an agent; its handle may be reused */
+	void RemoveAgent(int32 Handle);
+
+	/* Asks the agent to fire one shot during the next batch */
+	void RequestFire(int32 Handle);
+
+	/* Holds or releases the agent's trigger; a held trigger fires every time the cooldown allows */
+	void SetTriggerHeld(int32 Handle, bool bHeld);
+
+	/* Asks a headless agent to start a timed reload during the next batch */
+	void RequestReload(int32 Handle);
+
+	/* Refills the agent's magazine right away and lets it fire again, for views whose reload is timed by their character */
+	void ApplyReload(int32 Handle);
+
+	/* Marks the agent as changing weapon; it cannot fire meanwhile */
+	void SetChangingWeapon(int32 Handle, bool bChangingWeapon);
+
+	/* Is this handle a live agent ? */
+	FORCEINLINE bool IsValidAgent(int32 Handle) const
+	{
+		return Flags.IsValidIndex(Handle) && (Flags[Handle] & EWeaponAgentFlags::Alive) != 0;
+	}
+
+	/* Ammo currently in the agent's magazine */
+	FORCEINLINE int32 GetAmmoInMag(int32 Handle) const
+	{
+		return AmmoInMag[Handle];
+	}
+
+	/* Ammo currently in the agent's backpack */
+	FORCEINLINE int32 GetAmmoInBackpack(int32 Handle) const
+	{
+		return AmmoInBackpack[Handle];
+	}
+
+	/* Is the agent reloading ? */
+	FORCEINLINE bool IsReloading(int32 Handle) const
+	{
+		return (Flags[Handle] & EWeaponAgentFlags::Reloading) != 0;
+	}
+
+	/* How many agents are alive */
+	FORCEINLINE int32 GetNumAgents() const
+	{
+		return Flags.Num() - FreeHandles.Num();
+	}
+
+	/* Runs one batch of fire, reload and cooldown logic over every agent */
+	void Simulate(float DeltaTime);
+
+	/* Bytes allocated by the per agent arrays */
+	SIZE_T GetAllocatedSize() const;
+
+public:
+
+	/* UGameplayWorldManager interface */
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+
+private:
+
+	/* Simulates the agents in [BeginIndex, EndIndex); runs on worker threads */
+	void SimulateRange(int32 BeginIndex, int32 EndIndex, float DeltaTime);
+
+	/* Writes the state of the bound agents back to their weapons and fires their shots */
+	void SyncViews();
+
+private:
+
+	/* Per agent state, one entry per handle */
+	TArray<int32> AmmoInMag;
+	TArray<int32> AmmoInBackpack;
+	TArray<int32> MaxAmmoInMag;
+	TArray<int32> MaxAmmoInBackpack;
+	TArray<float> ReloadTime;
+	TArray<float> FireInterval;
+	TArray<float> ReloadRemaining;
+	TArray<float> CooldownRemaining;
+	TArray<uint8> Flags;
+	TArray<uint8> PendingShots;
+	TArray<uint8> ShotsFired;
+
+	/* The weapon each agent is a view of, if any */
+	TArray<TWeakObjectPtr<ABaseWeapon>> Views;
+
+	/* Handles of removed agents, ready to be reused */
+	TArray<int32> FreeHandles;
+};
@@ -0,0 +1,182 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameplayWorldManager.h"
+#include "Curves/CurveFloat.h"
+#include "WeaponTimelineScheduler.generated.h"
+
+class AGameplayPlayerCharacter;
+
+UENUM(BlueprintType)
+enum class EWeaponTimelineType : uint8
+{
+	WTT_Equip		UMETA(DisplayName = "Equip"),
+	WTT_ReloadDown	UMETA(DisplayName = "ReloadDown"),
+	WTT_ReloadUp	UMETA(DisplayName = "ReloadUp")
+};
+
+/* A float curve sampled at a fixed rate, evaluated by interpolating between the two nearest samples */
+struct FBakedWeaponCurve
+{
+	/* Time of the first sample */
+	float MinTime;
+
+	/* Samples per second */
+	float SampleRate;
+
+	/* Values of the curve from MinTime on, one every 1 / SampleRate seconds */
+	TArray<float> Samples;
+
+	FBakedWeaponCurve()
+		: MinTime(0.0f)
+		, SampleRate(0.0f)
+	{
+	}
+
+	/* Value of the curve at Time; times outside the samples get the first or last sample */
+	FORCEINLINE float Evaluate(float Time) const
+	{
+		const float SamplePosition = FMath::Clamp((Time - MinTime) * SampleRate, 0.0f, (float)(Samples.Num() - 1));
+		const int32 Sample = FMath::Min(FMath::TruncToInt(SamplePosition), Samples.Num() - 2);
+		return FMath::Lerp(Samples[Sample], Samples[Sample + 1], SamplePosition - Sample);
+	}
+};
+
+/* A weapon timeline of one character that is currently playing */
+USTRUCT()
+struct FActiveWeaponTimeline
+{
+	GENERATED_USTRUCT_BODY()
+
+	/* The character this timeline animates */
+	TWeakObjectPtr<AGameplayPlayerCharacter> Character;
+
+	/* The curve sampled while the timeline plays */
+	UPROPERTY()
+	UCurveFloat* Curve;
+
+	/* Index of the curve's lookup table in the scheduler, or INDEX_NONE */
+	int32 BakedCurve;
+
+	/* Which of the character's timelines this is */
+	EWeaponTimelineType Type;
+
+	/* Current playback position, in seconds */
+	float Position;
+
+	/* Where the timeline ends, in seconds */
+	float Length;
+
+	/* When the timeline event fires, in seconds; negative if there is none */
+	float EventTime;
+
+	/* Has the timeline event already fired ? */
+	bool bEventFired;
+
+	FActiveWeaponTimeline()
+		: Curve(nullptr)
+		, BakedCurve(INDEX_NONE)
+		, Type(EWeaponTimelineType::WTT_Equip)
+		, Position(0.0f)
+		, Length(0.0f)
+		, EventTime(-1.0f)
+		, bEventFired(false)
+	{
+	}
+};
+
+/**
+ * Plays the equip and reload timelines of every character of the world.
+ * Only timelines that are actually playing are stored, packed in one array
+ * and advanced together once per frame, so idle characters cost nothing.
+ *
+ * Curves are baked once into lookup tables shared by every character, so a
+ * playing timeline costs one interpolation per frame instead of a search
+ * through the curve's keys.
+ */
+UCLASS()
+class SHOOTERTUTORIAL_API UWeaponTimelineScheduler : public UGameplayWorldManager
+{
+	GENERATED_BODY()
+
+public:
+
+	/* Gets the timeline scheduler of the given world, if the world uses AGameplayGameState */
+	static UWeaponTimelineScheduler* Get(const UWorld* World);
+
+	/* Plays a timeline of the character from the start, restarting it if it was already playing */
+	void Play(AGameplayPlayerCharacter* Character, EWeaponTimelineType Type, UCurveFloat* Curve, float EventTime = -1.0f);
+
+	/* Bakes the lookup table of a curve, if it is not baked yet, and returns its index or INDEX_NONE for no curve */
+	int32 BakeCurve(UCurveFloat* Curve);
+
+	/* Stops a timeline of the character without firing its finish notification */
+	void Stop(AGameplayPlayerCharacter* Character, EWeaponTimelineType Type);
+
+	/* Is this timeline of the character playing ? */
+	bool IsPlaying(const AGameplayPlayerCharacter* Character, EWeaponTimelineType Type) const;
+
+	/* Bytes allocated by the baked lookup tables */
+	SIZE_T GetBakedCurvesAllocatedSize() const;
+
+	/* How many timelines are playing in the world */
+	FORCEINLINE int32 GetNumActiveTimelines() const
+	{
+		return ActiveTimelines.Num();
+	}
+
+public:
+
+	/* How many samples per second curves are baked with */
+	UPROPERTY(EditAnywhere, Category = "Timeline", meta = (ClampMin = "1.0"))
+	float BakeSampleRate = 60.0f;
+
+	/* Largest difference from its curve a lookup table may have; tables above it are baked again at twice the rate */
+	UPROPERTY(EditAnywhere, Category = "Timeline", meta = (ClampMin = "0.0"))
+	float BakeTolerance = 0.005f;
+
+	/* Most samples a single lookup table may hold */
+	UPROPERTY(EditAnywhere, Category = "Timeline", meta = (ClampMin = "2"))
+	int32 MaxBakedSamples = 1024;
+
+public:
+
+	/* UGameplayWorldManager interface */
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+
+private:
+
+	/* Finds the index of a playing timeline, or INDEX_NONE */
+	int32 FindTimeline(const AGameplayPlayerCharacter* Character, EWeaponTimelineType Type) const;
+
+	/* Samples a curve into a lookup table at the given rate and returns the largest difference from the curve */
+	static float SampleCurve(const UCurveFloat* Curve, float SampleRate, int32 MaxSamples, FBakedWeaponCurve& OutBakedCurve);
+
+private:
+
+	/* A notification raised while advancing, sent once every timeline has been advanced */
+	struct FPendingNotification
+	{
+		TWeakObjectPtr<AGameplayPlayerCharacter> Character;
+		EWeaponTimelineType Type;
+		bool bFinished;
+	};
+
+	/* Every timeline currently playing */
+	UPROPERTY()
+	TArray<FActiveWeaponTimeline> ActiveTimelines;
+
+	/* Every baked curve, kept loaded for as long as its table is used */
+	UPROPERTY()
+	TArray<UCurveFloat*> BakedCurveAssets;
+
+	/* Lookup table of every baked curve, in the order of BakedCurveAssets */
+	TArray<FBakedWeaponCurve> BakedCurves;
+
+	/* Scratch list reused every frame */
+	TArray<FPendingNotification> PendingNotifications;
+};
@@ -3,4 +3,8 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "Stats/Stats.h"
+
+/* Game thread cost of this module, shown with "stat ShooterTutorial" */
+DECLARE_STATS_GROUP(TEXT("ShooterTutorial"), STATGROUP_ShooterTutorial, STATCAT_Advanced);
 